@@ -3,9 +3,91 @@
 #include <random>    // Для генерации случайных чисел
 #include <algorithm> // Для алгоритмов (сортировка, поиск)
 #include <fstream>   // Для работы с файлами
+#include <iomanip>   // Для setprecision (вывод бенчмарка)
+#include <chrono>    // Для замера времени в бенчмарке
+#include <cmath>     // Для llround (заполнение узлов при массовой загрузке)
+#include <cstring>   // Для strcmp
+#include <climits>   // Для ULLONG_MAX
+#include "seeded_random.h" // Для воспроизводимой генерации по зерну (общей с sorting.cpp)
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>  // Для векторных инструкций AVX2
+#define BTREE_HAS_X86_SIMD 1
+#endif
 
 using namespace std; // Использование стандартного пространства имен
 
+// ===== Поиск позиции ключа в узле =====
+//
+// Все функции возвращают количество ключей узла, меньших key (то есть позицию, как lower_bound),
+// и не содержат ветвлений, зависящих от данных: при сотнях ключей в узле неверно предсказанные
+// переходы линейного цикла стоят дороже самих сравнений.
+
+// Узлы порядка не больше этого ищутся подсчетом сравнений всех ключей (AVX2), большие - двоичным поиском
+const int LINEAR_SEARCH_MAX_ORDER = 16;
+
+// Подсчет ключей меньше key без ветвлений: результат сравнения (0 или 1) прибавляется к счетчику
+inline int countLessScalar(const int* keys, int count, int key) {
+    int less = 0;
+    for (int i = 0; i < count; i++) {
+        less += keys[i] < key;
+    }
+    return less;
+}
+
+#ifdef BTREE_HAS_X86_SIMD
+// Тот же подсчет по 8 ключей: сравнение в регистре AVX2, маска знаковых бит и popcount
+__attribute__((target("avx2,popcnt")))
+int countLessAvx2(const int* keys, int count, int key) {
+    __m256i needle = _mm256_set1_epi32(key);
+    int less = 0, i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i block = _mm256_loadu_si256((const __m256i*)(keys + i));
+        __m256i isLess = _mm256_cmpgt_epi32(needle, block);  // keys[i] < key
+        less += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(isLess)));
+    }
+    return less + countLessScalar(keys + i, count - i, key);
+}
+
+// Поддерживает ли процессор AVX2 (определяется один раз при запуске)
+const bool CPU_HAS_AVX2 = __builtin_cpu_supports("avx2");
+#endif
+
+inline int countLess(const int* keys, int count, int key) {
+#ifdef BTREE_HAS_X86_SIMD
+    if (count >= 8 && CPU_HAS_AVX2) return countLessAvx2(keys, count, key);  // Меньше 8 ключей - один неполный регистр
+#endif
+    return countLessScalar(keys, count, key);
+}
+
+// Двоичный поиск без ветвлений: отрезок всегда делится пополам, выбор половины - условная пересылка (cmov)
+inline int branchlessLowerBound(const int* keys, int count, int key) {
+    if (count == 0) return 0;
+    const int* base = keys;
+    while (count > 1) {
+        int half = count / 2;
+        base = base[half] < key ? base + half : base;
+        count -= half;
+    }
+    return (base - keys) + (*base < key);
+}
+
+/**
+ * Позиция ключа в узле порядка Order; способ поиска выбирается при компиляции
+ *
+ * Небольшие узлы (до LINEAR_SEARCH_MAX_ORDER) помещаются в несколько строк кэша, и подсчет
+ * всех сравнений векторными инструкциями быстрее; в больших узлах двоичный поиск делает
+ * log2(Order) сравнений вместо Order.
+ */
+template <int Order>
+inline int nodeLowerBound(const int* keys, int count, int key) {
+    if constexpr (Order <= LINEAR_SEARCH_MAX_ORDER) {
+        return countLess(keys, count, key);
+    } else {
+        return branchlessLowerBound(keys, count, key);
+    }
+}
+
 // Структура узла B-дерева
 struct BTreeNode {
     vector<int> keys;            // Вектор ключей в узле
@@ -24,14 +106,13 @@ struct BTreeNode {
         children.reserve(m);     // Резервируем место для максимум m потомков
     }
 
-    // Поиск позиции ключа в узле
+    // Поиск позиции ключа в узле (первый ключ, не меньший key)
+    // Порядок этого узла известен только при запуске, поэтому вариант nodeLowerBound выбирается
+    // одним сравнением, которое для всех узлов дерева дает один и тот же результат
     int findKey(int key) {
-        int idx = 0;             // Начинаем с первой позиции
-        // Ищем позицию, где должен находиться ключ
-        while (idx < keys.size() && keys[idx] < key) {
-            ++idx;               // Переходим к следующей позиции
-        }
-        return idx;              // Возвращаем найденную позицию
+        return order <= LINEAR_SEARCH_MAX_ORDER
+                   ? nodeLowerBound<LINEAR_SEARCH_MAX_ORDER>(keys.data(), keys.size(), key)
+                   : nodeLowerBound<LINEAR_SEARCH_MAX_ORDER + 1>(keys.data(), keys.size(), key);
     }
 
     // Проверка, полон ли узел (содержит максимальное количество ключей)
@@ -57,11 +138,8 @@ struct BTreeNode {
             }
             keys[i + 1] = key;   // Вставляем ключ на найденную позицию
         } else {                 // Если это внутренний узел
-            // Находим дочерний узел для вставки
-            while (i >= 0 && keys[i] > key) {
-                i--;             // Ищем правильного потомка
-            }
-            i++;                 // Переходим к найденному потомку
+            // Находим дочерний узел для вставки (ключа в дереве нет, поэтому это позиция ключа в узле)
+            i = findKey(key);
 
             // Если дочерний узел полон, разделяем его
             if (children[i]->isFull()) {
@@ -110,11 +188,7 @@ struct BTreeNode {
 
     // Поиск ключа в поддереве
     BTreeNode* search(int key) {
-        int i = 0;               // Начинаем с первого ключа
-        // Ищем позицию ключа в текущем узле
-        while (i < keys.size() && key > keys[i]) {
-            i++;                 // Переходим к следующему ключу
-        }
+        int i = findKey(key);    // Позиция ключа в текущем узле
 
         // Если нашли ключ в текущем узле
         if (i < keys.size() && keys[i] == key) {
@@ -130,6 +204,18 @@ struct BTreeNode {
         return children[i]->search(key);
     }
 
+    // Прежний поиск с линейным просмотром ключей (для сравнения в бенчмарке)
+    BTreeNode* searchLinear(int key) {
+        int i = 0;
+        while (i < keys.size() && key > keys[i]) {
+            i++;
+        }
+        if (i < keys.size() && keys[i] == key) {
+            return this;
+        }
+        return isLeaf ? nullptr : children[i]->searchLinear(key);
+    }
+
     // Обход дерева в порядке возрастания (in-order traversal)
     void traverse() {
         int i;
@@ -244,6 +330,19 @@ struct BTree {
         root = nullptr;   // Изначально дерево пустое
     }
 
+    // Освобождение всех узлов; после вызова дерево пустое
+    void clear() {
+        if (root == nullptr) return;
+        vector<BTreeNode*> pending = {root};  // Без рекурсии: узлы, которые еще нужно удалить
+        while (!pending.empty()) {
+            BTreeNode* node = pending.back();
+            pending.pop_back();
+            pending.insert(pending.end(), node->children.begin(), node->children.end());
+            delete node;
+        }
+        root = nullptr;
+    }
+
     // Поиск ключа в дереве
     BTreeNode* search(int key) {
         // Если дерево пустое, возвращаем nullptr, иначе ищем в корне
@@ -286,6 +385,127 @@ struct BTree {
         return true;  // Ключ успешно вставлен
     }
 
+    // Количество узлов одного уровня при массовой загрузке: units "единиц" (у листьев - ключ и разделитель
+    // справа от него, у внутренних узлов - потомок) делятся поровну между узлами так, чтобы узел был заполнен
+    // примерно на fillFactor и не меньше минимума B-дерева (order/2 потомков, order/2 - 1 ключей)
+    size_t bulkNodeCount(size_t units, double fillFactor) {
+        size_t minUnits = max(2, order / 2), maxUnits = order;
+        size_t target = min(maxUnits, max(minUnits, (size_t)llround(fillFactor * maxUnits)));
+        size_t count = (units + target - 1) / target;
+        while (count > 1 && units / count < minUnits) {
+            count--;  // Иначе последние узлы оказались бы меньше минимума; узлы станут полнее, но не больше order
+        }
+        return count;
+    }
+
+    /**
+     * Массовая загрузка пустого дерева из строго возрастающей последовательности ключей
+     *
+     * Дерево строится снизу вверх без поиска и разделений: ключи раскладываются по листьям подряд,
+     * ключ между соседними листьями становится разделителем, разделители так же раскладываются по
+     * узлам следующего уровня, пока не останется один узел - корень. fillFactor из (0, 1] - доля
+     * заполнения узлов: меньше 1 оставляет место для последующих insert без разделений.
+     * Возвращает false, если дерево не пустое, ключи не возрастают строго или fillFactor вне (0, 1].
+     */
+    bool bulkLoad(const vector<int>& sortedKeys, double fillFactor = 1.0) {
+        if (root != nullptr) {
+            cout << "Массовая загрузка возможна только в пустое дерево!" << endl;
+            return false;
+        }
+        if (!(fillFactor > 0 && fillFactor <= 1)) {
+            cout << "Коэффициент заполнения должен быть в диапазоне (0, 1]!" << endl;
+            return false;
+        }
+        for (size_t i = 1; i < sortedKeys.size(); i++) {
+            if (sortedKeys[i - 1] >= sortedKeys[i]) {
+                cout << "Ключи для массовой загрузки должны строго возрастать!" << endl;
+                return false;
+            }
+        }
+        if (sortedKeys.empty()) return true;
+
+        // Уровень листьев: n ключей = ключи листьев + (листьев - 1) разделителей
+        vector<BTreeNode*> level;
+        vector<int> separators;  // separators[i] - ключ между level[i] и level[i + 1]
+        size_t units = sortedKeys.size() + 1;
+        size_t count = bulkNodeCount(units, fillFactor);
+        auto key = sortedKeys.begin();
+        for (size_t i = 0; i < count; i++) {
+            size_t keyCount = units / count + (i < units % count) - 1;
+            BTreeNode* leaf = new BTreeNode();
+            leaf->order = order;  // Без initialize: листу не нужен запас под потомков
+            leaf->isLeaf = true;
+            leaf->keys.reserve(order - 1);
+            leaf->keys.assign(key, key + keyCount);
+            key += keyCount;
+            if (i + 1 < count) separators.push_back(*key++);
+            level.push_back(leaf);
+        }
+
+        // Внутренние уровни: потомки текущего уровня группируются, разделители между группами идут выше
+        while (level.size() > 1) {
+            vector<BTreeNode*> upper;
+            vector<int> upperSeparators;
+            units = level.size();
+            count = bulkNodeCount(units, fillFactor);
+            size_t child = 0;
+            for (size_t i = 0; i < count; i++) {
+                size_t childCount = units / count + (i < units % count);
+                BTreeNode* node = new BTreeNode();
+                node->initialize(order, false);
+                node->children.assign(level.begin() + child, level.begin() + child + childCount);
+                node->keys.assign(separators.begin() + child, separators.begin() + child + childCount - 1);
+                child += childCount;
+                if (i + 1 < count) upperSeparators.push_back(separators[child - 1]);
+                upper.push_back(node);
+            }
+            level.swap(upper);
+            separators.swap(upperSeparators);
+        }
+        root = level[0];
+        return true;
+    }
+
+    // Проверка свойств B-дерева (см. validateProperties): листья на одной глубине, в узлах кроме корня
+    // от order/2 - 1 до order - 1 ключей, у внутренних узлов потомков на один больше, чем ключей, и не меньше
+    // order/2 (у корня - 2), ключи строго возрастают и лежат между разделителями предка.
+    // leaves и leafKeys - число листьев и ключей в них (по ним видно, сколько места осталось в листьях)
+    bool checkProperties(size_t& leaves, size_t& leafKeys) const {
+        leaves = leafKeys = 0;
+        int leafDepth = -1;
+        return root == nullptr || checkNode(root, 0, leafDepth, nullptr, nullptr, leaves, leafKeys);
+    }
+
+    // Проверка поддерева node на глубине depth; low и high - разделители предка (nullptr - без границы)
+    bool checkNode(const BTreeNode* node, int depth, int& leafDepth, const int* low, const int* high,
+                   size_t& leaves, size_t& leafKeys) const {
+        size_t keyCount = node->keys.size();
+        bool isRoot = node == root;
+        if (keyCount > (size_t)order - 1 || (!isRoot && keyCount + 1 < (size_t)(order / 2))) return false;
+        for (size_t i = 1; i < keyCount; i++) {
+            if (node->keys[i - 1] >= node->keys[i]) return false;
+        }
+        if (keyCount > 0 && ((low && node->keys.front() <= *low) || (high && node->keys.back() >= *high))) {
+            return false;
+        }
+        if (node->isLeaf) {
+            if (leafDepth < 0) leafDepth = depth;
+            leaves++;
+            leafKeys += keyCount;
+            return node->children.empty() && depth == leafDepth;
+        }
+        size_t minChildren = isRoot ? 2 : max(2, order / 2);
+        if (node->children.size() != keyCount + 1 || node->children.size() < minChildren) return false;
+        for (size_t i = 0; i <= keyCount; i++) {
+            const int* childLow = i > 0 ? &node->keys[i - 1] : low;
+            const int* childHigh = i < keyCount ? &node->keys[i] : high;
+            if (!checkNode(node->children[i], depth + 1, leafDepth, childLow, childHigh, leaves, leafKeys)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
     // Вывод дерева в порядке возрастания
     void traverse() {
         if (root != nullptr) {  // Если дерево не пустое
@@ -330,10 +550,633 @@ struct BTree {
 
 };
 
+// ===== B-дерево с узлами фиксированного размера =====
+//
+// В BTreeNode ключи и потомки лежат в двух отдельных векторах, то есть посещение узла - три
+// обращения к разным местам кучи (сам узел, keys, children), а каждое выделение памяти несет
+// служебный заголовок. FixedBTree<Order> хранит ключи и потомков прямо в узле: размер узла известен
+// при компиляции, узел выровнен по строке кэша, а листья (их большинство) не хранят массив потомков.
+// Узлы берутся из пула, который принадлежит дереву и освобождается целиком.
+
+const size_t CACHE_LINE_SIZE = 64;
+
+// Примерный размер блока кучи под запрос bytes (malloc в glibc: заголовок 8 байт, выравнивание 16,
+// минимум 32) - для сравнения памяти BTree и FixedBTree
+inline size_t heapBlockSize(size_t bytes) {
+    return max<size_t>(32, (bytes + 8 + 15) / 16 * 16);
+}
+
+// Память под узлы BTree, байт: каждый узел - до трех блоков кучи (сам узел, keys, children)
+size_t memoryBytes(const BTree& tree) {
+    size_t bytes = 0;
+    vector<const BTreeNode*> pending;
+    if (tree.root != nullptr) pending.push_back(tree.root);
+    while (!pending.empty()) {
+        const BTreeNode* node = pending.back();
+        pending.pop_back();
+        pending.insert(pending.end(), node->children.begin(), node->children.end());
+        bytes += heapBlockSize(sizeof(BTreeNode));
+        if (node->keys.capacity() > 0) bytes += heapBlockSize(node->keys.capacity() * sizeof(int));
+        if (node->children.capacity() > 0) bytes += heapBlockSize(node->children.capacity() * sizeof(BTreeNode*));
+    }
+    return bytes;
+}
+
+// Пул узлов: узлы нарезаются подряд из больших блоков (slab), освобождаются все сразу
+template <typename T>
+struct NodePool {
+    static const size_t SLAB_BYTES = 64 * 1024;
+    static const size_t NODES_PER_SLAB = SLAB_BYTES / sizeof(T) > 0 ? SLAB_BYTES / sizeof(T) : 1;
+
+    vector<T*> slabs;                     // Выделенные блоки
+    size_t usedInSlab = NODES_PER_SLAB;   // Сколько узлов занято в последнем блоке
+
+    NodePool() = default;
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+    ~NodePool() { clear(); }
+
+    // Новый узел (неинициализированный)
+    T* allocate() {
+        if (usedInSlab == NODES_PER_SLAB) {
+            slabs.push_back(new T[NODES_PER_SLAB]);  // Выравнивание T соблюдается (aligned new)
+            usedInSlab = 0;
+        }
+        return &slabs.back()[usedInSlab++];
+    }
+
+    // Освобождение всех узлов пула
+    void clear() {
+        for (T* slab : slabs) delete[] slab;
+        slabs.clear();
+        usedInSlab = NODES_PER_SLAB;
+    }
+
+    // Память, занятая блоками пула, байт
+    size_t memoryBytes() const {
+        return slabs.size() * heapBlockSize(NODES_PER_SLAB * sizeof(T));
+    }
+};
+
+// B-дерево порядка Order с теми же правилами вставки, что и BTree (разделение полных узлов по пути вниз)
+template <int Order>
+struct FixedBTree {
+    static_assert(Order >= 3, "Порядок B-дерева должен быть не менее 3");
+
+    // Лист: только ключи
+    struct alignas(CACHE_LINE_SIZE) Node {
+        int count;             // Количество ключей
+        bool isLeaf;           // Флаг: является ли узел листом
+        int keys[Order - 1];   // Ключи в порядке возрастания
+    };
+    // Внутренний узел: ключи и потомки
+    struct InnerNode : Node {
+        Node* children[Order];  // children[i] - ключи меньше keys[i]
+    };
+
+    Node* root = nullptr;        // Указатель на корень дерева
+    NodePool<Node> leaves;       // Пул листьев
+    NodePool<InnerNode> inners;  // Пул внутренних узлов
+
+    static InnerNode* inner(Node* node) {
+        return static_cast<InnerNode*>(node);
+    }
+
+    // Освобождение всех узлов; после вызова дерево пустое
+    void clear() {
+        root = nullptr;
+        leaves.clear();
+        inners.clear();
+    }
+
+    // Память под узлы дерева, байт
+    size_t memoryBytes() const {
+        return leaves.memoryBytes() + inners.memoryBytes();
+    }
+
+    Node* newNode(bool leaf) {
+        Node* node = leaf ? leaves.allocate() : inners.allocate();
+        node->count = 0;
+        node->isLeaf = leaf;
+        return node;
+    }
+
+    // Поиск ключа в дереве; способ поиска в узле выбирается при компиляции (nodeLowerBound)
+    bool search(int key) const {
+        const Node* node = root;
+        while (node != nullptr) {
+            int i = nodeLowerBound<Order>(node->keys, node->count, key);
+            if (i < node->count && node->keys[i] == key) return true;
+            node = node->isLeaf ? nullptr : static_cast<const InnerNode*>(node)->children[i];
+        }
+        return false;
+    }
+
+    // Разделение полного потомка y = x->children[i] (как BTreeNode::splitChild)
+    void splitChild(InnerNode* x, int i, Node* y) {
+        const int midIndex = (Order - 1) / 2;
+        Node* z = newNode(y->isLeaf);
+        z->count = y->count - midIndex - 1;
+        memcpy(z->keys, y->keys + midIndex + 1, z->count * sizeof(int));
+        if (!y->isLeaf) {
+            memcpy(inner(z)->children, inner(y)->children + midIndex + 1, (z->count + 1) * sizeof(Node*));
+        }
+        y->count = midIndex;
+
+        // z становится правым соседом y, средний ключ поднимается в x
+        memmove(x->children + i + 2, x->children + i + 1, (x->count - i) * sizeof(Node*));
+        x->children[i + 1] = z;
+        memmove(x->keys + i + 1, x->keys + i, (x->count - i) * sizeof(int));
+        x->keys[i] = y->keys[midIndex];
+        x->count++;
+    }
+
+    // Вставка ключа с проверкой на дубликаты; false - ключ уже есть
+    bool insert(int key) {
+        if (search(key)) return false;
+        if (root == nullptr) {
+            root = newNode(true);
+        } else if (root->count == Order - 1) {  // Полный корень: новый корень над ним
+            InnerNode* temp = inner(newNode(false));
+            temp->children[0] = root;
+            splitChild(temp, 0, root);
+            root = temp;
+        }
+
+        Node* node = root;
+        while (!node->isLeaf) {
+            int i = nodeLowerBound<Order>(node->keys, node->count, key);
+            Node* child = inner(node)->children[i];
+            if (child->count == Order - 1) {
+                splitChild(inner(node), i, child);
+                if (node->keys[i] < key) i++;  // Ключ попадает в правую половину
+            }
+            node = inner(node)->children[i];
+        }
+        int pos = nodeLowerBound<Order>(node->keys, node->count, key);
+        memmove(node->keys + pos + 1, node->keys + pos, (node->count - pos) * sizeof(int));
+        node->keys[pos] = key;
+        node->count++;
+        return true;
+    }
+};
+
+// B+ дерево
+// данные хранятся только в листьях, внутренние узлы содержат только ключи для навигации
+// все листья связаны в список по указателю next, что позволяет эффективно выполнять последовательное сканирование:
+// диапазон читается подряд по листьям, без возврата к корню и без рекурсии
+// ключи из листьев дублируются во внутренних узлах для навигации (разделитель - первый ключ правого листа)
+// внутренние узлы компактнее, так как содержат только ключи
+
+// Структура узла B+ дерева
+struct BPlusNode {
+    vector<int> keys;             // Лист: ключи записей; внутренний узел: разделители
+    vector<int> values;           // Значения записей (только в листе), values[i] соответствует keys[i]
+    vector<BPlusNode*> children;  // Потомки (только во внутреннем узле), children.size() == keys.size() + 1
+    BPlusNode* next;              // Следующий лист в порядке возрастания ключей (только в листе)
+    bool isLeaf;                  // Флаг: является ли узел листом
+    int order;                    // Порядок дерева (максимальное количество потомков)
+
+    // Функция инициализации узла (как в BTreeNode)
+    void initialize(int m, bool leaf) {
+        order = m;
+        isLeaf = leaf;
+        next = nullptr;
+        keys.clear();
+        values.clear();
+        children.clear();
+        keys.reserve(m - 1);              // Максимум m-1 ключей
+        if (leaf) values.reserve(m - 1);
+        else children.reserve(m);
+    }
+
+    // Номер потомка, в поддереве которого лежит ключ: ключи, равные разделителю, лежат справа
+    int findChild(int key) {
+        return upper_bound(keys.begin(), keys.end(), key) - keys.begin();
+    }
+
+    // Проверка, полон ли узел (содержит максимальное количество ключей)
+    bool isFull() {
+        return (int)keys.size() == order - 1;
+    }
+
+    // Разделение полного потомка children[i]
+    void splitChild(int i) {
+        BPlusNode* y = children[i];
+        BPlusNode* z = new BPlusNode();
+        z->initialize(order, y->isLeaf);
+        int midIndex = (order - 1) / 2;
+
+        if (y->isLeaf) {
+            // Лист: правая половина записей уходит в z, копия первого ключа z становится разделителем
+            z->keys.assign(y->keys.begin() + midIndex, y->keys.end());
+            z->values.assign(y->values.begin() + midIndex, y->values.end());
+            y->keys.resize(midIndex);
+            y->values.resize(midIndex);
+            z->next = y->next;  // z встает в список листьев сразу за y
+            y->next = z;
+            keys.insert(keys.begin() + i, z->keys[0]);
+        } else {
+            // Внутренний узел: как в B-дереве, средний разделитель поднимается в текущий узел
+            z->keys.assign(y->keys.begin() + midIndex + 1, y->keys.end());
+            z->children.assign(y->children.begin() + midIndex + 1, y->children.end());
+            keys.insert(keys.begin() + i, y->keys[midIndex]);
+            y->keys.resize(midIndex);
+            y->children.resize(midIndex + 1);
+        }
+        children.insert(children.begin() + i + 1, z);
+    }
+
+    // Вывод структуры поддерева (как BTreeNode::printTree; в листьях - пары ключ:значение)
+    void printTree(string prefix = "", bool isLast = true, int childIndex = -1) {
+        cout << prefix << (isLast ? "└── " : "├── ");
+        if (childIndex >= 0) {
+            cout << "(" << childIndex << ") ";
+        }
+        cout << "[";
+        for (int i = 0; i < (int)keys.size(); i++) {
+            if (i > 0) cout << ", ";
+            cout << keys[i];
+            if (isLeaf) cout << ":" << values[i];
+        }
+        cout << "]" << (isLeaf ? " [ЛИСТ]" : "") << endl;
+
+        for (int i = 0; i < (int)children.size(); i++) {
+            children[i]->printTree(prefix + (isLast ? "    " : "│   "), i == (int)children.size() - 1, i);
+        }
+    }
+};
+
+// Структура B+ дерева: отображение ключ -> значение с упорядоченным обходом диапазонов
+struct BPlusTree {
+    BPlusNode* root;  // Указатель на корень дерева
+    int order;        // Порядок дерева
+    int size;         // Количество записей
+
+    // Функция инициализации B+ дерева (заменяет конструктор)
+    void initialize(int m) {
+        order = m;
+        root = nullptr;
+        size = 0;
+    }
+
+    // Освобождение всех узлов; после вызова дерево пустое
+    void clear() {
+        if (root == nullptr) return;
+        vector<BPlusNode*> pending = {root};  // Без рекурсии: узлы, которые еще нужно удалить
+        while (!pending.empty()) {
+            BPlusNode* node = pending.back();
+            pending.pop_back();
+            pending.insert(pending.end(), node->children.begin(), node->children.end());
+            delete node;
+        }
+        root = nullptr;
+        size = 0;
+    }
+
+    // Лист, в котором лежит (или должен лежать) ключ
+    BPlusNode* findLeaf(int key) {
+        BPlusNode* node = root;
+        while (node != nullptr && !node->isLeaf) {
+            node = node->children[node->findChild(key)];
+        }
+        return node;
+    }
+
+    // Поиск значения по ключу; nullptr - ключа нет
+    int* search(int key) {
+        BPlusNode* leaf = findLeaf(key);
+        if (leaf == nullptr) return nullptr;
+        auto it = lower_bound(leaf->keys.begin(), leaf->keys.end(), key);
+        if (it == leaf->keys.end() || *it != key) return nullptr;
+        return &leaf->values[it - leaf->keys.begin()];
+    }
+
+    // Вставка записи; если ключ уже есть, заменяется его значение и возвращается false
+    bool insert(int key, int value) {
+        if (root == nullptr) {
+            root = new BPlusNode();
+            root->initialize(order, true);
+        }
+        // Как в BTree::insert: полные узлы разделяются по пути вниз, поэтому подъема обратно не требуется
+        if (root->isFull()) {
+            BPlusNode* temp = new BPlusNode();
+            temp->initialize(order, false);
+            temp->children.push_back(root);
+            temp->splitChild(0);
+            root = temp;
+        }
+        BPlusNode* node = root;
+        while (!node->isLeaf) {
+            int i = node->findChild(key);
+            if (node->children[i]->isFull()) {
+                node->splitChild(i);
+                if (key >= node->keys[i]) i++;  // Ключ попадает в правую половину
+            }
+            node = node->children[i];
+        }
+
+        int pos = lower_bound(node->keys.begin(), node->keys.end(), key) - node->keys.begin();
+        if (pos < (int)node->keys.size() && node->keys[pos] == key) {
+            node->values[pos] = value;
+            return false;
+        }
+        node->keys.insert(node->keys.begin() + pos, key);
+        node->values.insert(node->values.begin() + pos, value);
+        size++;
+        return true;
+    }
+
+    /**
+     * Последовательный обход записей с ключами из [lo, hi] в порядке возрастания
+     *
+     * Спуск от корня выполняется один раз - к листу с lo, дальше записи читаются подряд
+     * по списку листьев. visit(key, value) вызывается для каждой записи; если visit
+     * возвращает false, обход прекращается. Возвращает число переданных записей.
+     */
+    template <typename Visit>
+    int scan(int lo, int hi, Visit visit) {
+        int visited = 0;
+        BPlusNode* leaf = findLeaf(lo);
+        if (leaf == nullptr || lo > hi) return 0;
+        int i = lower_bound(leaf->keys.begin(), leaf->keys.end(), lo) - leaf->keys.begin();
+        for (; leaf != nullptr; leaf = leaf->next, i = 0) {
+            for (; i < (int)leaf->keys.size(); i++) {
+                if (leaf->keys[i] > hi) return visited;
+                visited++;
+                if (!visit(leaf->keys[i], leaf->values[i])) return visited;
+            }
+        }
+        return visited;
+    }
+
+    // Вывод структуры дерева в консоль
+    void printStructure() {
+        if (root != nullptr) {
+            cout << "\nСтруктура B+ дерева порядка " << order << " (записей: " << size << "):" << endl;
+            root->printTree();
+        } else {
+            cout << "Дерево пустое!" << endl;
+        }
+    }
+};
+
+// ===== Бенчмарк (--bench): вставка и поиск в B-деревьях порядков 4..256 =====
+//
+// Ключи - нечетные числа 1, 3, ..., 2n-1, вставленные в случайном порядке; запросы - случайные числа
+// из [0, 2n], так что примерно половина запросов - промахи. Данные генерируются по зерну (seeded_random.h).
+
+// Параметры бенчмарка из командной строки
+struct BenchmarkOptions {
+    size_t keys = 1000000;     // Количество ключей в дереве (--keys)
+    size_t lookups = 1000000;  // Количество запросов поиска (--lookups)
+    size_t repetitions = 3;    // Замеров каждой операции, берется лучший (--repeat)
+    uint64_t seed = 42;        // Зерно генератора (--seed)
+    double fillFactor = 0.7;   // Заполнение узлов при второй массовой загрузке, (0, 1] (--fill)
+};
+
+// Разбор аргументов бенчмарка; false - неверный аргумент
+bool parseBenchmarkArguments(int argc, char* argv[], BenchmarkOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--bench") continue;
+        if (arg == "--fill") {
+            char* end = nullptr;
+            double value = i + 1 < argc ? strtod(argv[i + 1], &end) : 0;
+            if (i + 1 >= argc || end == argv[i + 1] || *end != '\0' || !(value > 0 && value <= 1)) {
+                cerr << "Ошибка: после --fill ожидается доля заполнения узлов из (0, 1]" << endl;
+                return false;
+            }
+            options.fillFactor = value;
+            i++;
+            continue;
+        }
+        if (arg != "--keys" && arg != "--lookups" && arg != "--repeat" && arg != "--seed") {
+            cerr << "Неизвестный аргумент: " << arg << endl;
+            return false;
+        }
+        const char* text = i + 1 < argc ? argv[i + 1] : "";
+        char* end = nullptr;
+        errno = 0;
+        unsigned long long value = strtoull(text, &end, 10);
+        unsigned long long limit = arg == "--seed" ? ULLONG_MAX : arg == "--repeat" ? 1000 : 1u << 30;
+        // strtoull сам принимает знак минус и пробелы - число должно начинаться с цифры
+        if (*text < '0' || *text > '9' || *end != '\0' || errno == ERANGE || (arg != "--seed" && value == 0) ||
+            value > limit) {
+            cerr << "Ошибка: после " << arg
+                 << (arg == "--seed"     ? " ожидается неотрицательное число"
+                     : arg == "--repeat" ? " ожидается положительное число (не больше 1000)"
+                                         : " ожидается положительное число (не больше 2^30)")
+                 << endl;
+            return false;
+        }
+        if (arg == "--keys") options.keys = value;
+        if (arg == "--lookups") options.lookups = value;
+        if (arg == "--repeat") options.repetitions = value;
+        if (arg == "--seed") options.seed = value;
+        i++;
+    }
+    return true;
+}
+
+// Нечетные ключи 1, 3, ..., 2n-1 в случайном порядке (перемешивание Фишера-Йетса по зерну)
+vector<int> generateBenchmarkKeys(size_t n, uint64_t seed) {
+    vector<int> keys(n);
+    for (size_t i = 0; i < n; i++) {
+        keys[i] = (int)(2 * i + 1);
+    }
+    for (size_t i = n; i > 1; i--) {
+        swap(keys[i - 1], keys[seededRandomValue<size_t>(seed, i, 0, i - 1)]);
+    }
+    return keys;
+}
+
+// Лучшее время из repetitions запусков run(), секунды; prepare() перед каждым запуском в замер не входит
+template <typename Prepare, typename Run>
+double bestSeconds(size_t repetitions, Prepare prepare, Run run) {
+    double best = 0;
+    for (size_t rep = 0; rep < repetitions; rep++) {
+        prepare();
+        auto start = chrono::steady_clock::now();
+        run();
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        best = rep == 0 ? seconds : min(best, seconds);
+    }
+    return best;
+}
+
+template <typename Run>
+double bestSeconds(size_t repetitions, Run run) {
+    return bestSeconds(repetitions, [] {}, run);
+}
+
+// Данные бенчмарка, общие для всех порядков
+struct BenchmarkData {
+    vector<int> keys;      // Ключи в порядке вставки
+    vector<int> sortedKeys;  // Те же ключи по возрастанию (для массовой загрузки)
+    vector<int> queries;   // Запросы поиска
+    size_t expectedFound;  // Сколько запросов должно найтись
+};
+
+// Проверка дерева после массовой загрузки: свойства B-дерева, каждый ключ находится, запросы находят
+// нужное число ключей; leafFillPercent - заполнение листьев, % от order - 1 ключей
+bool checkBulkTree(BTree& tree, const BenchmarkData& data, double& leafFillPercent) {
+    size_t leaves, leafKeys;
+    bool correct = tree.checkProperties(leaves, leafKeys);
+    leafFillPercent = leaves > 0 ? 100.0 * leafKeys / (leaves * (tree.order - 1)) : 0;
+    for (int key : data.sortedKeys) correct = correct && tree.search(key) != nullptr;
+    size_t found = 0;
+    for (int query : data.queries) found += tree.search(query) != nullptr;
+    return correct && found == data.expectedFound;
+}
+
+/**
+ * Замеры для одного порядка: B-дерево с узлами на векторах (BTree) и с узлами фиксированного размера
+ * (FixedBTree<Order>) строятся из одних и тех же ключей; поиск в BTree замеряется и прежним линейным
+ * просмотром (searchLinear). Выводит объект JSON; возвращает true, если все поиски нашли нужное число ключей.
+ */
+template <int Order>
+bool benchmarkOrder(const BenchmarkData& data, const BenchmarkOptions& options, bool last) {
+    BTree tree;
+    tree.initialize(Order);
+    // Освобождение дерева прошлого замера во время вставки не входит
+    double insertSeconds = bestSeconds(options.repetitions, [&] { tree.clear(); }, [&] {
+        for (int key : data.keys) tree.insert(key);
+    });
+    BTree bulkTree;
+    bulkTree.initialize(Order);
+    double bulkSeconds = bestSeconds(options.repetitions, [&] { bulkTree.clear(); },
+                                     [&] { bulkTree.bulkLoad(data.sortedKeys); });
+    double bulkLeafFill;
+    bool bulkCorrect = checkBulkTree(bulkTree, data, bulkLeafFill);
+    // Неполные узлы: место под последующие вставки
+    double partialBulkSeconds = bestSeconds(options.repetitions, [&] { bulkTree.clear(); },
+                                            [&] { bulkTree.bulkLoad(data.sortedKeys, options.fillFactor); });
+    double partialLeafFill;
+    bulkCorrect = checkBulkTree(bulkTree, data, partialLeafFill) && bulkCorrect;
+    bulkTree.clear();
+
+    FixedBTree<Order> fixedTree;
+    double fixedInsertSeconds = bestSeconds(options.repetitions, [&] { fixedTree.clear(); }, [&] {
+        for (int key : data.keys) fixedTree.insert(key);
+    });
+
+    size_t foundLinear = 0, foundSearch = 0, foundFixed = 0;
+    double linearSeconds = bestSeconds(options.repetitions, [&] {
+        foundLinear = 0;
+        for (int query : data.queries) foundLinear += tree.root->searchLinear(query) != nullptr;
+    });
+    double searchSeconds = bestSeconds(options.repetitions, [&] {
+        foundSearch = 0;
+        for (int query : data.queries) foundSearch += tree.search(query) != nullptr;
+    });
+    double fixedSearchSeconds = bestSeconds(options.repetitions, [&] {
+        foundFixed = 0;
+        for (int query : data.queries) foundFixed += fixedTree.search(query);
+    });
+    bool correct = foundLinear == data.expectedFound && foundSearch == data.expectedFound &&
+                   foundFixed == data.expectedFound && bulkCorrect;
+    size_t vectorBytes = memoryBytes(tree);
+    size_t fixedBytes = fixedTree.memoryBytes();
+    tree.clear();
+
+    double perKey = 1e9 / data.keys.size(), perLookup = 1e9 / data.queries.size();
+    cout << fixed << setprecision(1);
+    cout << "    {" << endl;
+    cout << "      \"order\": " << Order << "," << endl;
+    cout << "      \"strategy\": \"" << (Order <= LINEAR_SEARCH_MAX_ORDER ? "count" : "binary") << "\"," << endl;
+    cout << "      \"correct\": " << (correct ? "true" : "false") << "," << endl;
+    cout << "      \"found\": " << foundFixed << "," << endl;
+    cout << "      \"linear_ns_per_lookup\": " << linearSeconds * perLookup << "," << endl;
+    cout << "      \"vector_node\": {\"insert_ns_per_key\": " << insertSeconds * perKey
+         << ", \"bulk_load_ns_per_key\": " << bulkSeconds * perKey << ", \"bulk_leaf_fill_percent\": " << bulkLeafFill
+         << ", \"partial_bulk_load_ns_per_key\": " << partialBulkSeconds * perKey
+         << ", \"partial_leaf_fill_percent\": " << partialLeafFill
+         << ", \"search_ns_per_lookup\": " << searchSeconds * perLookup << ", \"memory_bytes\": " << vectorBytes
+         << ", \"node_bytes\": " << sizeof(BTreeNode) << "}," << endl;
+    cout << "      \"fixed_node\": {\"insert_ns_per_key\": " << fixedInsertSeconds * perKey
+         << ", \"search_ns_per_lookup\": " << fixedSearchSeconds * perLookup << ", \"memory_bytes\": " << fixedBytes
+         << ", \"leaf_bytes\": " << sizeof(typename FixedBTree<Order>::Node)
+         << ", \"inner_bytes\": " << sizeof(typename FixedBTree<Order>::InnerNode) << "}," << endl;
+    cout << setprecision(2);
+    cout << "      \"search_speedup\": " << linearSeconds / searchSeconds << "," << endl;
+    cout << "      \"bulk_load_speedup\": " << insertSeconds / bulkSeconds << "," << endl;
+    cout << "      \"fixed_search_speedup\": " << searchSeconds / fixedSearchSeconds << "," << endl;
+    cout << "      \"fixed_insert_speedup\": " << insertSeconds / fixedInsertSeconds << "," << endl;
+    cout << setprecision(1);
+    cout << "      \"memory_saved_percent\": " << 100.0 * (1 - (double)fixedBytes / vectorBytes) << endl;
+    cout << "    }" << (last ? "" : ",") << endl;
+    return correct;
+}
+
+/**
+ * Бенчмарк B-деревьев порядков 4..256: вставка, поиск (search_speedup - поиск findKey против прежнего
+ * линейного цикла, fixed_* - узлы фиксированного размера против узлов на векторах) и память;
+ * bulk_load_speedup - массовая загрузка из уже отсортированных ключей (bulkLoad) против вставки тех же ключей
+ * по одному в случайном порядке (сортировка в замер не входит); partial_* - та же загрузка с заполнением узлов
+ * на долю --fill. После каждой загрузки проверяются свойства B-дерева и поиск всех ключей.
+ * Результат - JSON в stdout, время - по лучшему замеру, наносекунд на ключ или на запрос.
+ */
+int runBenchmark(const BenchmarkOptions& options) {
+    BenchmarkData data;
+    data.keys = generateBenchmarkKeys(options.keys, options.seed);
+    data.sortedKeys = data.keys;
+    sort(data.sortedKeys.begin(), data.sortedKeys.end());
+    data.queries.resize(options.lookups);
+    fillSeededRandom(data.queries.data(), data.queries.size(), 0, (int)(2 * options.keys), options.seed + 1,
+                     thread::hardware_concurrency());
+    data.expectedFound = 0;  // Нечетные запросы меньше 2n есть в дереве
+    for (int query : data.queries) {
+        data.expectedFound += query % 2 == 1;
+    }
+
+    cout << "{" << endl;
+    cout << "  \"benchmark\": \"btree\"," << endl;
+    cout << "  \"keys\": " << options.keys << "," << endl;
+    cout << "  \"lookups\": " << options.lookups << "," << endl;
+    cout << "  \"repetitions\": " << options.repetitions << "," << endl;
+    cout << "  \"seed\": " << options.seed << "," << endl;
+    cout << "  \"fill_factor\": " << options.fillFactor << "," << endl;
+#ifdef BTREE_HAS_X86_SIMD
+    cout << "  \"avx2\": " << (CPU_HAS_AVX2 ? "true" : "false") << "," << endl;
+#else
+    cout << "  \"avx2\": false," << endl;
+#endif
+    cout << "  \"linear_search_max_order\": " << LINEAR_SEARCH_MAX_ORDER << "," << endl;
+    cout << "  \"results\": [" << endl;
+
+    bool allCorrect = true;
+    allCorrect = benchmarkOrder<4>(data, options, false) && allCorrect;
+    allCorrect = benchmarkOrder<8>(data, options, false) && allCorrect;
+    allCorrect = benchmarkOrder<16>(data, options, false) && allCorrect;
+    allCorrect = benchmarkOrder<32>(data, options, false) && allCorrect;
+    allCorrect = benchmarkOrder<64>(data, options, false) && allCorrect;
+    allCorrect = benchmarkOrder<128>(data, options, false) && allCorrect;
+    allCorrect = benchmarkOrder<256>(data, options, true) && allCorrect;
+
+    cout << "  ]" << endl;
+    cout << "}" << endl;
+    return allCorrect ? 0 : 1;
+}
+
 // Главная функция программы
-int main() {
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--bench") == 0) {
+            BenchmarkOptions options;
+            return parseBenchmarkArguments(argc, argv, options) ? runBenchmark(options) : 1;
+        }
+    }
+
+    uint64_t seed = 0;                                     // Зерно для случайного заполнения
+    bool seedGiven;                                        // Задано ли оно через --seed N
+    if (!findSeedArgument(argc, argv, seed, seedGiven)) {
+        return 1;  // Неверное зерно: случайное вместо него сделало бы запуск невоспроизводимым
+    }
+
     int order;    // Переменная для хранения порядка дерева
     int choice;   // Переменная для выбора пользователя
+    vector<int> keysInOrder;  // Ключи в порядке ввода (для B+ дерева)
     
     // Приветствие и ввод порядка дерева
     cout << "=== Программа построения B-дерева ===" << endl;
@@ -376,17 +1219,23 @@ int main() {
             return 1;   // Выходим с кодом ошибки
         }
         
-        // Настраиваем генератор случайных чисел
-        random_device rd;                        // Источник энтропии
-        mt19937 gen(rd());                       // Генератор Mersenne Twister
-        uniform_int_distribution<> dis(1, 100);  // Равномерное распределение от 1 до 100
+        // Без --seed берем зерно из источника энтропии
+        if (!seedGiven) {
+            random_device rd;                        // Источник энтропии
+            seed = (uint64_t(rd()) << 32) | rd();
+        }
+        // Числа от 1 до 100 по зерну: одно зерно - одна и та же последовательность
+        vector<int> values(count);
+        fillSeededRandom(values.data(), values.size(), 1, 100, seed, thread::hardware_concurrency());
         
-        cout << "\nГенерируемые числа: ";
+        cout << "\nЗерно генератора: " << seed << endl;
+        cout << "Генерируемые числа: ";
         int inserted = 0;  // Счетчик успешно вставленных элементов
+        keysInOrder = values;
         
-        // Генерируем и вставляем случайные числа
+        // Вставляем сгенерированные числа
         for (int i = 0; i < count; i++) {
-            int value = dis(gen);       // Генерируем случайное число
+            int value = values[i];      // Очередное случайное число
             cout << value << " ";       // Выводим сгенерированное число
             if (tree.insert(value)) {   // Пытаемся вставить число
                 inserted++;             // Увеличиваем счетчик при успешной вставке
@@ -413,6 +1262,7 @@ int main() {
         for (int i = 0; i < count; i++) {
             int value;         // Переменная для текущего числа
             cin >> value;      // Читаем число от пользователя
+            keysInOrder.push_back(value);
             if (tree.insert(value)) {  // Пытаемся вставить число
                 inserted++;    // Увеличиваем счетчик при успешной вставке
             }
@@ -431,13 +1281,29 @@ int main() {
     // Показываем свойства B-дерева
     tree.validateProperties();
 
+    // Те же ключи в B+ дереве: значение записи - порядковый номер ключа при вводе
+    BPlusTree plus;
+    plus.initialize(order);
+    for (int i = 0; i < (int)keysInOrder.size(); i++) {
+        plus.insert(keysInOrder[i], i);
+    }
+    plus.printStructure();
+
+    // Сканирование середины диапазона ключей по списку листьев
+    int lo = *min_element(keysInOrder.begin(), keysInOrder.end());
+    int hi = *max_element(keysInOrder.begin(), keysInOrder.end());
+    int quarter = (int)(((long long)hi - lo) / 4);
+    lo += quarter;
+    hi -= quarter;
+    cout << "\nСканирование диапазона [" << lo << ", " << hi << "] (ключ:значение): ";
+    int found = plus.scan(lo, hi, [](int key, int value) {
+        cout << key << ":" << value << " ";
+        return true;
+    });
+    cout << endl << "Найдено записей: " << found << endl;
+    plus.clear();
+    tree.clear();
+
     return 0;  // Успешное завершение программы
 }
 
-
-// B+ дерево
-// данные хранятся только в листьях, внутренние узлы содержат только ключи для навигации
-// все листья связаны в двусвязный список, что позволяет эффективно выполнять последовательное сканирование
-// *двусвязный список - тип данных, где каждая узел(элемент) хранит предыдущий и следующий элемент
-// ключи из листьев дублируются во внутренних узлах для навигации
-// внутренние узлы компактнее, так как содержат только ключи
\ No newline at end of file
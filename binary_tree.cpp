@@ -2,6 +2,7 @@
 #include <random>
 #include <vector>
 #include <fstream>
+#include "seeded_random.h" // Генерация по зерну, общая с sorting.cpp
 
 using namespace std;
 
@@ -130,7 +131,14 @@ public:
     }
 };
 
-int main() {
+int main(int argc, char* argv[]) {
+    // С аргументом --seed N автоматическая генерация воспроизводима (те же числа, что и у sorting.cpp)
+    uint64_t seed = 0;
+    bool seedGiven;
+    if (!findSeedArgument(argc, argv, seed, seedGiven)) {
+        return 1;
+    }
+
     BinarySearchTree bst;
     int n, method;
     
@@ -165,14 +173,16 @@ int main() {
     }
     else if (method == 2) {
         // Автоматическая генерация
-        random_device rd;
-        mt19937 gen(rd());
-        uniform_int_distribution<> dis(1, n);
+        if (!seedGiven) {
+            random_device rd;
+            seed = (uint64_t(rd()) << 32) | rd();
+        }
+        numbers.resize(n);
+        fillSeededRandom(numbers.data(), numbers.size(), 1, n, seed, thread::hardware_concurrency());
         
-        cout << "\nСгенерированные числа: ";
-        for (int i = 0; i < n; i++) {
-            int num = dis(gen);
-            numbers.push_back(num);
+        cout << "\nЗерно генератора: " << seed << endl;
+        cout << "Сгенерированные числа: ";
+        for (int num : numbers) {
             cout << num << " ";
         }
         cout << endl;
@@ -1,174 +1,2466 @@
 #include <iostream> 
 #include <map>       // Для ассоциативного контейнера map (частоты символов и коды)
-#include <queue>     // Для приоритетной очереди (priority_queue) при построении дерева
 #include <string>    // Для работы со строками
-#include <vector>    // Для контейнера vector (используется в priority_queue)
+#include <vector>    // Для контейнера vector (узлы дерева, сжатые данные)
 #include <iomanip>   // Для форматирования вывода (setprecision)
+#include <cstdint>   // Для uint8_t, uint64_t (упакованный битовый поток)
+#include <algorithm> // Для fill, max, sort
+#include <chrono>    // Для замера скорости декодирования в самопроверке
+#include <cmath>     // Для log2 (оценка энтропии блока)
+#include <cstring>   // Для memcpy, memcmp
+#include <cstdio>    // Для поблочного чтения и записи файлов (fread/fwrite)
+#include <cstdlib>   // Для strtoull
+#include <cerrno>    // Для errno (переполнение в strtoull)
+#include <climits>   // Для ULLONG_MAX
+#include <thread>    // Для параллельного сжатия блоков
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <atomic>
+#include <memory>    // Для unique_ptr (буфер сжатого файла)
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>  // Для getrusage - пиковый объем памяти в бенчмарке
+#define HUFFMAN_HAS_RUSAGE 1
+#include <fcntl.h>     // Для open
+#include <sys/mman.h>  // Для mmap - входной файл сжатия отображается в память без копирования
+#include <sys/stat.h>  // Для fstat
+#include <unistd.h>    // Для write, close, fork
+#define HUFFMAN_HAS_MMAP 1
+#include <sys/wait.h>  // Для wait4 - память каждого файла бенчмарка меряется в отдельном процессе
+#define HUFFMAN_HAS_FORK 1
+#endif
+
+#include "seeded_random.h"  // Для воспроизводимой генерации данных бенчмарка
 
 using namespace std;
 
 // Структура Node представляет узел бинарного дерева Хаффмана
+// Узлы лежат в одном массиве HuffmanTree::nodes, потомки задаются индексами в нем
 struct Node {
-    char character;  // Символ (заполняется только в листьях дерева)
-    int frequency;   // Частота символа или сумма частот поддерева
-    Node* left;      // Указатель на левого потомка (код 0)
-    Node* right;     // Указатель на правого потомка (код 1)
-    
-    // Первый для листьев (с символом), второй для внутренних узлов (без символа)
-    Node(char ch, int freq) : character(ch), frequency(freq), left(nullptr), right(nullptr) {}
-    Node(int freq) : character('\0'), frequency(freq), left(nullptr), right(nullptr) {}
+    uint64_t frequency;      // Частота символа или сумма частот поддерева
+    int left;                // Индекс левого потомка (код 0), -1 у листа
+    int right;               // Индекс правого потомка (код 1), -1 у листа
+    unsigned char character; // Символ (заполняется только в листьях дерева)
+};
+
+// Дерево Хаффмана: сначала листья по возрастанию частоты, затем внутренние узлы в порядке создания
+// Массив фиксированного размера - построение дерева для блока не выделяет память в куче
+struct HuffmanTree {
+    Node nodes[2 * 256 - 1];  // Не больше 256 листьев и 255 внутренних узлов
+    int nodeCount = 0;
+    int root = -1;            // -1 - пустое дерево (в тексте нет символов)
+};
+
+// Частоты всех 256 значений байта
+struct Histogram {
+    uint64_t counts[256] = {};
 };
 
+// Подсчет частот байтов за один проход
+// Четыре таблицы счетчиков по очереди: подряд идущие одинаковые байты увеличивают разные ячейки,
+// и процессору не приходится ждать, пока предыдущее увеличение той же ячейки дойдет до памяти
+Histogram calculateFrequencies(const uint8_t* data, size_t size) {
+    uint64_t partial[4][256] = {};  // 8 КиБ - целиком в кэше L1
+    size_t i = 0;
+    // По 8 байт за итерацию: одно 64-битное чтение вместо восьми однобайтовых
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        partial[0][word & 0xFF]++;
+        partial[1][(word >> 8) & 0xFF]++;
+        partial[2][(word >> 16) & 0xFF]++;
+        partial[3][(word >> 24) & 0xFF]++;
+        partial[0][(word >> 32) & 0xFF]++;
+        partial[1][(word >> 40) & 0xFF]++;
+        partial[2][(word >> 48) & 0xFF]++;
+        partial[3][word >> 56]++;
+    }
+    for (; i < size; i++) {
+        partial[0][data[i]]++;
+    }
+
+    Histogram histogram;
+    for (int c = 0; c < 256; c++) {
+        histogram.counts[c] = partial[0][c] + partial[1][c] + partial[2][c] + partial[3][c];
+    }
+    return histogram;
+}
+
+Histogram calculateFrequencies(const string& text) {
+    return calculateFrequencies((const uint8_t*)text.data(), text.size());
+}
 
-// Compare определяет порядок в min-heap для алгоритма Хаффмана
-struct Compare {
-    bool operator()(Node* a, Node* b) {
-        // Если частоты равны, сравниваем по символу для детерминированности
-        if (a->frequency == b->frequency) {
-            return a->character > b->character;  // Лексикографический порядок
+// Построение дерева за линейное время методом двух очередей
+// алгоритм: берем два узла с минимальными частотами, объединяем их. Листья заранее отсортированы,
+// а новые узлы создаются с неубывающими суммами, поэтому минимум всегда лежит в начале одной из
+// двух очередей (непросмотренные листья или непросмотренные внутренние узлы) - куча не нужна
+HuffmanTree buildHuffmanTree(const Histogram& histogram) {
+    HuffmanTree tree;
+    for (int c = 0; c < 256; c++) {
+        if (histogram.counts[c] > 0) {
+            tree.nodes[tree.nodeCount++] = {histogram.counts[c], -1, -1, (unsigned char)c};
         }
-        // Основное сравнение: узел с МЕНЬШЕЙ частотой имеет БОЛЬШИЙ приоритет
-        return a->frequency > b->frequency;  // Min-heap: меньше = выше приоритет
     }
-};
+    int leafCount = tree.nodeCount;
+    if (leafCount == 0) return tree;
+    // Листья по возрастанию частоты, при равных частотах - по символу (для детерминированности)
+    sort(tree.nodes, tree.nodes + leafCount, [](const Node& a, const Node& b) {
+        return a.frequency != b.frequency ? a.frequency < b.frequency : a.character < b.character;
+    });
 
-// Функция проходит по строке и увеличивает счетчик для каждого символа
-map<char, int> calculateFrequencies(const string& text) {
-    map<char, int> frequencies;  // Ассоциативный массив: символ → частота
-    // Проходим по каждому символу входной строки
-    for (char ch : text) {
-        frequencies[ch]++;  // Увеличиваем счетчик для данного символа
-        // Если символа не было, map автоматически создаст запись со значением 0
-    }
-    return frequencies;  // Возвращаем таблицу частот
-}
-
-// алгоритм: берем два узла с минимальными частотами, объединяем их
-Node* buildHuffmanTree(map<char, int>& frequencies) {
-    // Приоритетная очередь (min-heap) для хранения узлов по возрастанию частоты
-    priority_queue<Node*, vector<Node*>, Compare> pq; // min-heap - это граф с минимальным числом в корне и большими в листьях
-    // priority_queue - массив, где мы добавляем в конец и берем из начала
-    // Создаем листовые узлы для каждого символа
-    for (auto& pair : frequencies) { // frequencies - переменная содержащая частоты (который map)
-        // pair.first - символ, pair.second - частота
-        pq.push(new Node(pair.first, pair.second)); 
-    }
-    // 
-    // если только один уникальный символ в тексте
-    if (pq.size() == 1) {
-        Node* root = new Node(pq.top()->frequency);  // Создаем корень
-        root->left = pq.top();  // Единственный символ - левый потомок
-        return root;  // Код будет "0"
+    // если только один уникальный символ в тексте - корень с единственным левым потомком, код будет "0"
+    if (leafCount == 1) {
+        tree.nodes[tree.nodeCount++] = {tree.nodes[0].frequency, 0, -1, 0};
+        tree.root = 1;
+        return tree;
     }
-    
-    // Основной алгоритм Хаффмана
-    while (pq.size() > 1) {  // Пока есть более одного узла
-        // Извлекаем два узла с наименьшими частотами
-        Node* left = pq.top();
-        pq.pop();   // Узел с минимальной частотой
-        Node* right = pq.top(); 
-        pq.pop();  // Узел со следующей минимальной частотой
-        
-        // Создаем новый внутренний узел
-        Node* merged = new Node(left->frequency + right->frequency);  // Сумма частот, достанных с двух первых элементов очереди, в одном узле
-        merged->left = left;    // Левый потомок (код 0)
-        merged->right = right;  // Правый потомок (код 1)
-        
-        // Добавляем объединенный узел обратно в очередь
-        pq.push(merged);
+
+    int nextLeaf = 0;              // Начало очереди листьев
+    int nextInternal = leafCount;  // Начало очереди внутренних узлов (они дописываются в конец массива)
+    // Берет узел с меньшей частотой из начала одной из очередей; при равенстве - лист (дерево получается ниже)
+    auto takeMinimum = [&]() {
+        bool leafAvailable = nextLeaf < leafCount;
+        bool internalAvailable = nextInternal < tree.nodeCount;
+        if (leafAvailable && (!internalAvailable || tree.nodes[nextLeaf].frequency <= tree.nodes[nextInternal].frequency)) {
+            return nextLeaf++;
+        }
+        return nextInternal++;
+    };
+    for (int merges = 0; merges < leafCount - 1; merges++) {
+        int left = takeMinimum();   // Узел с минимальной частотой (код 0)
+        int right = takeMinimum();  // Узел со следующей минимальной частотой (код 1)
+        tree.nodes[tree.nodeCount++] = {tree.nodes[left].frequency + tree.nodes[right].frequency, left, right, 0};
     }
-    
-    // Последний оставшийся узел - корень дерева
-    return pq.top();
+
+    // Последний созданный узел - корень дерева
+    tree.root = tree.nodeCount - 1;
+    return tree;
 }
 
-// Рекурсивный обход дерева, накапливая бинарный код по пути
-void generateCodes(Node* root, string code, map<char, string>& codes) {
-    if (!root) return;  // Базовый случай: пустой узел
+// Максимальная длина кода, которую принимает 64-битный битовый буфер (7 бит могут ждать записи)
+// Для кода длины L нужна сумма частот >= Fib(L + 2), поэтому для текстов короче 5 * 10^11 байт
+// глубина дерева не превышает 56
+const int MAX_CODE_LENGTH = 56;
+
+// Ограничение длины кода по умолчанию: все коды помещаются в таблицу декодера (DECODE_TABLE_BITS),
+// а потери сжатия по сравнению с неограниченным кодом обычно меньше процента
+const int DEFAULT_CODE_LENGTH_LIMIT = 11;
+
+// Длины кодов не длиннее maxLength с минимальной суммарной длиной сообщения - алгоритм package-merge
+// (Larmore, Hirschberg). Требуется 2^maxLength >= числа встречающихся символов.
+//
+// Уровни от самого глубокого (длина maxLength) к первому: список уровня - листья, слитые по весу
+// с парами ("пакетами") соседних элементов списка предыдущего уровня. Из списка первого уровня
+// берутся 2n - 2 самых легких элемента; длина кода символа равна числу уровней, на которых его
+// лист попал в выбранные элементы. Выбранные элементы каждого уровня - всегда начало списка,
+// а пакеты из начала списка собраны из начала списка уровнем глубже, поэтому для восстановления
+// достаточно помнить, какой элемент лист, а какой пакет. Время O(n * maxLength), все массивы на стеке.
+void limitCodeLengths(const Histogram& histogram, int maxLength, uint8_t lengths[256]) {
+    struct Item {
+        uint64_t weight;
+        int symbol;
+    };
+    Item leaves[256];
+    int n = 0;
+    for (int c = 0; c < 256; c++) {
+        lengths[c] = 0;
+        if (histogram.counts[c] > 0) leaves[n++] = {histogram.counts[c], c};
+    }
+    if (n <= 1) {  // Единственный символ получает код из 1 бита
+        if (n == 1) lengths[leaves[0].symbol] = 1;
+        return;
+    }
+    sort(leaves, leaves + n, [](const Item& a, const Item& b) {
+        return a.weight != b.weight ? a.weight < b.weight : a.symbol < b.symbol;
+    });
+
+    // Списки уровней (levels[0] - самый глубокий): символ листа или -1 для пакета.
+    // В списке не больше 2n - 1 элементов; веса нужны только для двух соседних уровней
+    int16_t levels[MAX_CODE_LENGTH][2 * 256];
+    int levelSize[MAX_CODE_LENGTH];
+    uint64_t weights[2][2 * 256];
+    for (int i = 0; i < n; i++) {
+        levels[0][i] = (int16_t)leaves[i].symbol;
+        weights[0][i] = leaves[i].weight;
+    }
+    levelSize[0] = n;
+    for (int level = 1; level < maxLength; level++) {
+        const uint64_t* deeper = weights[(level - 1) & 1];
+        uint64_t* current = weights[level & 1];
+        int deeperSize = levelSize[level - 1], size = 0, leaf = 0, pair = 0;
+        while (leaf < n || pair + 1 < deeperSize) {
+            // При равных весах сначала лист - так же, как при построении дерева
+            if (pair + 1 >= deeperSize || (leaf < n && leaves[leaf].weight <= deeper[pair] + deeper[pair + 1])) {
+                current[size] = leaves[leaf].weight;
+                levels[level][size++] = (int16_t)leaves[leaf++].symbol;
+            } else {
+                current[size] = deeper[pair] + deeper[pair + 1];
+                levels[level][size++] = -1;
+                pair += 2;
+            }
+        }
+        levelSize[level] = size;
+    }
+
+    int selected = 2 * n - 2;  // Сколько элементов взять из начала списка текущего уровня
+    for (int level = maxLength - 1; level >= 0; level--) {
+        int packages = 0;
+        for (int i = 0; i < selected; i++) {
+            if (levels[level][i] < 0) {
+                packages++;
+            } else {
+                lengths[levels[level][i]]++;
+            }
+        }
+        selected = 2 * packages;
+    }
+}
+
+// Канонический код Хаффмана: по длинам кодов сами коды восстанавливаются однозначно,
+// поэтому в заголовок сжатых данных достаточно записать только длины
+struct CanonicalCode {
+    uint8_t lengths[256] = {};  // Длина кода каждого байта (0 - байт не встречается)
+    uint64_t codes[256] = {};   // Код байта: младшие lengths[c] бит, передается со старшего бита
+};
+
+// Рекурсивный обход дерева: длина кода символа равна глубине его листа
+void collectCodeLengths(const HuffmanTree& tree, int index, int depth, uint8_t lengths[256]) {
+    if (index < 0) return;  // Базовый случай: пустой узел
+    const Node& node = tree.nodes[index];
     
     // Если это лист (содержит символ)
-    if (!root->left && !root->right) {
-        // Если корень - единственный узел, код = "0"
-        codes[root->character] = code.empty() ? "0" : code;
+    if (node.left < 0 && node.right < 0) {
+        // Если корень - единственный узел, код все равно занимает 1 бит
+        lengths[node.character] = depth == 0 ? 1 : depth;
         return;
     }
     
-    // Рекурсивный обход:
-    generateCodes(root->left, code + "0", codes);   // Левый путь = добавить "0"
-    generateCodes(root->right, code + "1", codes);  // Правый путь = добавить "1"
+    // Рекурсивный обход: оба потомка на один уровень глубже
+    collectCodeLengths(tree, node.left, depth + 1, lengths);
+    collectCodeLengths(tree, node.right, depth + 1, lengths);
+}
+
+// Длины кодов по частотам: обычное дерево Хаффмана, а если оно глубже maxLength - package-merge
+// Ограничение не опускается ниже log2(числа символов), иначе коды не поместятся
+void buildCodeLengths(const Histogram& histogram, int maxLength, uint8_t lengths[256]) {
+    HuffmanTree tree = buildHuffmanTree(histogram);
+    fill(lengths, lengths + 256, 0);
+    collectCodeLengths(tree, tree.root, 0, lengths);
+
+    int longest = *max_element(lengths, lengths + 256);
+    if (longest <= maxLength) return;
+    int symbols = (tree.nodeCount + 1) / 2;  // В полном двоичном дереве n листьев и n - 1 внутренних узлов
+    int minimumLength = 1;
+    while ((1 << minimumLength) < symbols) minimumLength++;
+    limitCodeLengths(histogram, max(maxLength, minimumLength), lengths);
+}
+
+// Сколько бит займут данные с такими частотами при таких длинах кодов
+uint64_t encodedBitCount(const Histogram& histogram, const uint8_t lengths[256]) {
+    uint64_t bits = 0;
+    for (int c = 0; c < 256; c++) {
+        bits += histogram.counts[c] * lengths[c];
+    }
+    return bits;
+}
+
+// Назначает канонические коды: символы упорядочены по (длина, байт), коды идут подряд,
+// при переходе к следующей длине код сдвигается влево (как в DEFLATE)
+CanonicalCode buildCanonicalCode(const uint8_t lengths[256]) {
+    CanonicalCode code;
+    int lengthCount[MAX_CODE_LENGTH + 1] = {};  // Сколько символов имеют код каждой длины
+    for (int c = 0; c < 256; c++) {
+        code.lengths[c] = lengths[c];
+        lengthCount[lengths[c]]++;
+    }
+    lengthCount[0] = 0;  // Отсутствующие символы кодов не получают
+
+    // Первый код каждой длины
+    uint64_t nextCode[MAX_CODE_LENGTH + 2] = {};
+    uint64_t value = 0;
+    for (int length = 1; length <= MAX_CODE_LENGTH; length++) {
+        value = (value + lengthCount[length - 1]) << 1;
+        nextCode[length] = value;
+    }
+
+    // Внутри одной длины коды раздаются по возрастанию байта
+    for (int c = 0; c < 256; c++) {
+        if (lengths[c] > 0) {
+            code.codes[c] = nextCode[lengths[c]]++;
+        }
+    }
+    return code;
+}
+
+// Текстовое представление кода ("0101") для вывода на экран
+string codeToString(uint64_t code, int length) {
+    string bits;
+    for (int bit = length - 1; bit >= 0; bit--) {
+        bits += ((code >> bit) & 1) ? '1' : '0';
+    }
+    return bits;
 }
 
 
 // Рекурсивная функция с отслеживанием уровня вложенности и позиции
-void printTree(Node* root, string prefix = "", bool isLast = true) {
-    if (!root) return;  // Базовый случай
+void printTree(const HuffmanTree& tree, int index, string prefix = "", bool isLast = true) {
+    if (index < 0) return;  // Базовый случай
+    const Node& node = tree.nodes[index];
     
     // Выводим текущий уровень отступа
     cout << prefix;
     // Символы для древовидной структуры
     cout << (isLast ? "└── " : "├── ");  // └── для последнего, ├── для промежуточного
     
-    if (!root->left && !root->right) {
+    if (node.left < 0 && node.right < 0) {
         // ЛИСТ: выводим символ и его частоту
-        char ch = root->character;
+        char ch = node.character;
         // Обрабатываем специальные символы для читаемости
         if (ch == ' ') {
-            cout << "'SPACE' (" << root->frequency << ")" << endl;
+            cout << "'SPACE' (" << node.frequency << ")" << endl;
         } else if (ch == '\n') {
-            cout << "'NEWLINE' (" << root->frequency << ")" << endl;
+            cout << "'NEWLINE' (" << node.frequency << ")" << endl;
         } else if (ch == '\t') {
-            cout << "'TAB' (" << root->frequency << ")" << endl;
+            cout << "'TAB' (" << node.frequency << ")" << endl;
         } else {
-            cout << "'" << ch << "' (" << root->frequency << ")" << endl;
+            cout << "'" << ch << "' (" << node.frequency << ")" << endl;
         }
     } else {
         // выводим только сумму частот
-        cout << "[" << root->frequency << "]" << endl;
+        cout << "[" << node.frequency << "]" << endl;
     }
     
     // Формируем отступ для потомков
     string newPrefix = prefix + (isLast ? "    " : "│   ");
     
     // Рекурсивно выводим потомков
-    if (root->left && root->right) {
-        printTree(root->left, newPrefix, false);   // Левый потомок не последний
-        printTree(root->right, newPrefix, true);   // Правый потомок последний
-    } else if (root->left) {
-        printTree(root->left, newPrefix, true);    // Только левый потомок
-    } else if (root->right) {
-        printTree(root->right, newPrefix, true);   // Только правый потомок
+    if (node.left >= 0 && node.right >= 0) {
+        printTree(tree, node.left, newPrefix, false);   // Левый потомок не последний
+        printTree(tree, node.right, newPrefix, true);   // Правый потомок последний
+    } else if (node.left >= 0) {
+        printTree(tree, node.left, newPrefix, true);    // Только левый потомок
+    } else if (node.right >= 0) {
+        printTree(tree, node.right, newPrefix, true);   // Только правый потомок
     }
 }
 
-// Заменяем каждый символ его кодом Хаффмана и конкатенируем результат
-string encodeString(const string& text, map<char, string>& codes) {
-    string encoded = "";  // Результирующая строка битов
-    
+// Сколько байт за концом результата может затереть BitWriter: он записывает буфер по 8 байт сразу
+const size_t BIT_WRITER_SLACK = 8;
+
+// Записывает 8 байт числа старшим байтом вперед (порядок битового потока)
+inline void storeBigEndian64(uint64_t value, uint8_t* p) {
+#if defined(__GNUC__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    value = __builtin_bswap64(value);  // Одна инструкция вместо разборки по байтам
+    memcpy(p, &value, 8);
+#else
+    for (int i = 7; i >= 0; i--) {
+        p[i] = (uint8_t)value;
+        value >>= 8;
+    }
+#endif
+}
+
+// Битовый буфер: коды накапливаются в 64-битном регистре, наружу уходят целые байты
+// Пишет прямо в заранее выделенную память без проверок и выделений: вызывающий отвечает за то,
+// чтобы за концом результата было еще BIT_WRITER_SLACK байт
+struct BitWriter {
+    uint8_t* out;          // Куда пойдет следующий байт (он же - текущий неполный байт)
+    uint64_t buffer = 0;   // Накопленные биты, выровненные к старшему разряду
+    int count = 0;         // Сколько бит в буфере (после каждой записи меньше 8)
+
+    BitWriter(uint8_t* output) : out(output) {}
+
+    // Добавляет length (1..56) младших бит code (старший бит кода идет первым)
+    void put(uint64_t code, int length) {
+        buffer |= code << (64 - count - length);
+        count += length;
+        // Буфер записывается целиком, а указатель сдвигается на число заполненных байт - без цикла и ветвлений
+        storeBigEndian64(buffer, out);
+        int bytes = count >> 3;
+        out += bytes;
+        buffer <<= bytes * 8;
+        count &= 7;
+    }
+
+    // Дописывает последний неполный байт (недостающие биты - нули)
+    void flush() {
+        if (count > 0) {
+            *out++ = (uint8_t)(buffer >> 56);
+        }
+        buffer = 0;
+        count = 0;
+    }
+};
+
+// Число в формате varint: по 7 бит в байте, старший бит байта - признак продолжения
+// Возвращает позицию после записанного числа
+uint8_t* writeVarint(uint64_t value, uint8_t* out) {
+    while (value >= 0x80) {
+        *out++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = (uint8_t)value;
+    return out;
+}
+
+// Числа фиксированной длины в порядке little-endian (таблица переходов, контейнер)
+void writeU32(uint32_t value, uint8_t* out) {
+    for (int i = 0; i < 4; i++) out[i] = (uint8_t)(value >> (8 * i));
+}
+
+uint32_t readU32(const uint8_t* in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+void writeU64(uint64_t value, uint8_t* out) {
+    writeU32((uint32_t)value, out);
+    writeU32((uint32_t)(value >> 32), out + 4);
+}
+
+uint64_t readU64(const uint8_t* in) {
+    return readU32(in) | ((uint64_t)readU32(in + 4) << 32);
+}
+
+// Наибольший размер заголовка кодов: varint длины текста (до 10 байт), число символов и 256 пар
+const size_t MAX_CODE_HEADER_SIZE = 10 + 1 + 2 * 256;
+
+// Заголовок сжатых данных: длина текста и длины кодов встречающихся байтов
+// Формат: varint(длина текста), (число символов - 1), затем пары (байт, длина кода)
+// Возвращает позицию после заголовка (не дальше out + MAX_CODE_HEADER_SIZE)
+uint8_t* writeCodeHeader(uint64_t textLength, const CanonicalCode& code, uint8_t* out) {
+    out = writeVarint(textLength, out);
+    if (textLength == 0) return out;  // У пустого текста нет кодов
+    int used = 0;
+    for (int c = 0; c < 256; c++) {
+        if (code.lengths[c] > 0) used++;
+    }
+    *out++ = (uint8_t)(used - 1);  // 256 символов помещаются в байт как 255
+    for (int c = 0; c < 256; c++) {
+        if (code.lengths[c] > 0) {
+            *out++ = (uint8_t)c;
+            *out++ = code.lengths[c];
+        }
+    }
+    return out;
+}
+
+// Заменяем каждый символ его каноническим кодом и упаковываем биты в байты
+// Результат пишется в out (encodedSizeBound() + BIT_WRITER_SLACK байт); возвращается его размер
+size_t encodeBytes(const uint8_t* data, size_t size, const CanonicalCode& code, uint8_t* out) {
+    BitWriter writer(writeCodeHeader(size, code, out));
     // Проходим по каждому символу исходного текста
-    for (char ch : text) {
-        encoded += codes[ch];  // Добавляем код символа к результату
+    for (size_t i = 0; i < size; i++) {
+        writer.put(code.codes[data[i]], code.lengths[data[i]]);  // Добавляем код символа к результату
     }
-    
-    return encoded;  // Возвращаем закодированную строку
+    writer.flush();
+    return writer.out - out;
+}
+
+// ===== Четыре потока: текст делится на 4 части, каждая кодируется в свой битовый поток =====
+//
+// Формат: заголовок кодов (writeCodeHeader), таблица переходов - размеры первых трех потоков
+// в байтах (3 x 4 байта), затем четыре потока подряд. Первые три части по ceil(n / 4) символов,
+// последняя - остаток. Декодер ведет четыре независимых битовых буфера в одном цикле:
+// их поиски в таблице не зависят друг от друга и выполняются процессором параллельно.
+
+const int STREAM_COUNT = 4;
+const size_t STREAM_JUMP_TABLE_SIZE = 4 * (STREAM_COUNT - 1);
+
+// Длина части текста, которую кодирует каждый из первых трех потоков
+inline uint64_t streamSegmentLength(uint64_t textLength) {
+    return (textLength + STREAM_COUNT - 1) / STREAM_COUNT;
+}
+
+size_t encodeBytes4(const uint8_t* data, size_t size, const CanonicalCode& code, uint8_t* out) {
+    uint8_t* jumpTable = writeCodeHeader(size, code, out);
+    if (size == 0) return jumpTable - out;
+
+    uint64_t segment = streamSegmentLength(size);
+    BitWriter writer(jumpTable + STREAM_JUMP_TABLE_SIZE);
+    uint8_t* streamStart = writer.out;
+    for (int stream = 0; stream < STREAM_COUNT; stream++) {
+        size_t first = min<uint64_t>(size, stream * segment);
+        size_t last = stream == STREAM_COUNT - 1 ? size : min<uint64_t>(size, first + segment);
+        for (size_t i = first; i < last; i++) {
+            writer.put(code.codes[data[i]], code.lengths[data[i]]);
+        }
+        writer.flush();  // Каждый поток начинается с целого байта
+        if (stream < STREAM_COUNT - 1) {
+            writeU32((uint32_t)(writer.out - streamStart), jumpTable + 4 * stream);
+            streamStart = writer.out;
+        }
+    }
+    return writer.out - out;
 }
 
-// Сравниваем размер в битах до и после кодирования
-void printCompressionStats(const string& original, const string& encoded) {
-    int originalBits = original.length() * 8;  // ASCII: 8 бит на символ
-    int encodedBits = encoded.length();        // Количество бит в коде Хаффмана
+// Точный размер заголовка кодов
+size_t codeHeaderSize(uint64_t textLength, const CanonicalCode& code) {
+    uint8_t header[MAX_CODE_HEADER_SIZE];
+    return writeCodeHeader(textLength, code, header) - header;
+}
+
+// Верхняя граница размера результата encodeBytes (streams = 1) или encodeBytes4 по частотам символов:
+// заголовок, таблица переходов и по неполному байту в конце каждого потока
+size_t encodedSizeBound(const Histogram& histogram, uint64_t textLength, const CanonicalCode& code, int streams) {
+    size_t bytes = codeHeaderSize(textLength, code) + (encodedBitCount(histogram, code.lengths) + 7) / 8;
+    return streams == STREAM_COUNT ? bytes + STREAM_JUMP_TABLE_SIZE + STREAM_COUNT - 1 : bytes;
+}
+
+// Кодирование строки в новый массив (самопроверка, демонстрация): память выделяется один раз
+vector<uint8_t> encodeString(const string& text, const CanonicalCode& code) {
+    vector<uint8_t> encoded(encodedSizeBound(calculateFrequencies(text), text.size(), code, 1) + BIT_WRITER_SLACK);
+    encoded.resize(encodeBytes((const uint8_t*)text.data(), text.size(), code, encoded.data()));
+    return encoded;
+}
+
+vector<uint8_t> encodeString4(const string& text, const CanonicalCode& code) {
+    vector<uint8_t> encoded(encodedSizeBound(calculateFrequencies(text), text.size(), code, STREAM_COUNT) +
+                            BIT_WRITER_SLACK);
+    encoded.resize(encodeBytes4((const uint8_t*)text.data(), text.size(), code, encoded.data()));
+    return encoded;
+}
+
+// Сравниваем реальный размер в байтах до и после кодирования
+void printCompressionStats(const string& original, const vector<uint8_t>& encoded, size_t headerBytes,
+                           const CanonicalCode& code) {
+    size_t originalBytes = original.length();  // 1 байт на символ
+    size_t encodedBytes = encoded.size();      // Заголовок + битовый поток
     
     cout << "\n=== статистика сжатия ===" << endl;
-    cout << "Исходный размер: " << originalBits << " бит (" 
-         << original.length() << " символов × 8 бит)" << endl;
-    cout << "Размер после кодирования: " << encodedBits << " бит" << endl;
+    cout << "Исходный размер: " << originalBytes << " байт" << endl;
+    cout << "Размер после кодирования: " << encodedBytes << " байт (заголовок " << headerBytes
+         << " байт + данные " << encodedBytes - headerBytes << " байт)" << endl;
     
     // Вычисляем процент сжатия
     cout << "Степень сжатия: " << fixed << setprecision(2) 
-         << (double)encodedBits / originalBits * 100 << "%" << endl;
-    cout << "Экономия: " << originalBits - encodedBits << " бит" << endl;
+         << (double)encodedBytes / originalBytes * 100 << "%" << endl;
+    cout << "Экономия: " << (long long)originalBytes - (long long)encodedBytes << " байт" << endl;
+
+    // Цена ограничения длины кода: сравниваем с кодом по неограниченному дереву Хаффмана
+    Histogram histogram = calculateFrequencies(original);
+    uint8_t unlimited[256] = {};
+    HuffmanTree tree = buildHuffmanTree(histogram);
+    collectCodeLengths(tree, tree.root, 0, unlimited);
+    uint64_t limitedBits = encodedBitCount(histogram, code.lengths);
+    uint64_t unlimitedBits = encodedBitCount(histogram, unlimited);
+    cout << "Самый длинный код: " << (int)*max_element(code.lengths, code.lengths + 256) << " бит (без ограничения "
+         << (int)*max_element(unlimited, unlimited + 256) << " бит)" << endl;
+    cout << "Потери от ограничения длины кода: " << limitedBits - unlimitedBits << " бит";
+    if (unlimitedBits > 0) cout << " (" << (double)(limitedBits - unlimitedBits) / unlimitedBits * 100 << "%)";
+    cout << endl;
+}
+
+// Читает varint; false, если данные закончились раньше числа
+bool readVarint(const uint8_t*& pos, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && pos < end; shift += 7) {
+        uint8_t byte = *pos++;
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;  // Старший бит сброшен - последний байт числа
+    }
+    return false;
+}
+
+// Разбирает заголовок writeCodeHeader(); pos сдвигается на начало битового потока
+// Проверяет длины кодов (неравенство Крафта), чтобы испорченный заголовок не вызвал выход за таблицы
+bool readCodeHeader(const uint8_t*& pos, const uint8_t* end, uint64_t& textLength, uint8_t lengths[256]) {
+    fill(lengths, lengths + 256, 0);
+    if (!readVarint(pos, end, textLength)) return false;
+    if (textLength == 0) return true;
+    if (pos == end) return false;
+    int used = *pos++ + 1;
+    if (end - pos < 2 * used) return false;
+
+    uint64_t kraft = 0;  // Сумма 2^(MAX_CODE_LENGTH - длина) не должна превышать 2^MAX_CODE_LENGTH
+    for (int i = 0; i < used; i++) {
+        uint8_t symbol = *pos++;
+        uint8_t length = *pos++;
+        if (length == 0 || length > MAX_CODE_LENGTH || lengths[symbol] != 0) return false;
+        lengths[symbol] = length;
+        kraft += (uint64_t)1 << (MAX_CODE_LENGTH - length);
+    }
+    return kraft <= (uint64_t)1 << MAX_CODE_LENGTH;
 }
 
-int main() {
+// Читает 8 байт как число со старшим байтом первым (порядок битового потока)
+inline uint64_t loadBigEndian64(const uint8_t* p) {
+    uint64_t word;
+    memcpy(&word, p, 8);
+#if defined(__GNUC__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    return __builtin_bswap64(word);  // Одна инструкция вместо сборки по байтам
+#else
+    word = 0;
+    for (int i = 0; i < 8; i++) word = (word << 8) | p[i];
+    return word;
+#endif
+}
+
+// Битовый поток читается через 64-битный буфер, выровненный к старшему разряду
+struct BitReader {
+    const uint8_t* begin;  // Начало потока
+    const uint8_t* pos;    // Следующий непрочитанный байт
+    const uint8_t* end;    // Конец потока
+    uint64_t buffer = 0;   // Непрочитанные биты, первый - в старшем разряде
+    int count = 0;         // Сколько бит в буфере достоверны
+    uint64_t padding = 0;  // Сколько нулевых бит добавлено за концом потока
+
+    BitReader(const uint8_t* first, const uint8_t* last) : begin(first), pos(first), end(last) {}
+
+    // Дополняет буфер минимум до 56 бит (за концом потока - нули)
+    void refill() {
+        if (end - pos >= 8) {
+            // Быстрый путь: одно чтение 8 байт; биты недочитанного байта попадут в буфер
+            // повторно при следующем дополнении, но OR с теми же значениями их не портит
+            buffer |= loadBigEndian64(pos) >> count;
+            pos += (63 - count) >> 3;
+            count |= 56;
+        } else {
+            while (count <= 56 && pos < end) {
+                buffer |= (uint64_t)*pos++ << (56 - count);
+                count += 8;
+            }
+            if (pos == end) {  // Дальше потока нет - дополняем нулями
+                padding += 64 - count;
+                count = 64;
+            }
+        }
+    }
+
+    // Сколько бит прочитано; больше размера потока - поток оборвался
+    uint64_t bitsConsumed() const { return (uint64_t)(pos - begin) * 8 + padding - count; }
+    bool overrun() const { return bitsConsumed() > (uint64_t)(end - begin) * 8; }
+
+    uint64_t peek(int bits) const { return buffer >> (64 - bits); }
+
+    void consume(int bits) {
+        buffer <<= bits;
+        count -= bits;
+    }
+};
+
+// Число бит, по которым строится таблица декодирования (2^11 записей по 4 байта - 8 КиБ, помещается в L1)
+const int DECODE_TABLE_BITS = 11;
+
+// Запись таблицы: до двух символов, коды которых целиком помещаются в DECODE_TABLE_BITS бит
+struct DecodeEntry {
+    uint8_t symbol[2];  // Декодированные символы
+    uint8_t bits;       // Сколько бит занимают коды всех символов записи
+    uint8_t count;      // Число символов: 1 или 2; 0 - код длиннее таблицы
+};
+
+// Таблица для табличного декодера и данные для медленного пути (канонический разбор длинных кодов)
+struct DecodeTable {
+    DecodeEntry entries[1 << DECODE_TABLE_BITS];
+    uint64_t firstCode[MAX_CODE_LENGTH + 1];  // Первый код каждой длины
+    int firstIndex[MAX_CODE_LENGTH + 1];      // Номер первого символа этой длины в sortedSymbols
+    int lengthCount[MAX_CODE_LENGTH + 1];     // Число кодов каждой длины
+    uint8_t sortedSymbols[256];               // Символы в каноническом порядке (длина, байт)
+    uint8_t codeLengths[256];                 // Длина кода каждого символа
+    int maxLength;                            // Самая длинная длина кода
+};
+
+// Строит таблицу декодирования по длинам кодов
+void buildDecodeTable(const uint8_t lengths[256], DecodeTable& table) {
+    CanonicalCode code = buildCanonicalCode(lengths);
+    const int SIZE = 1 << DECODE_TABLE_BITS;
+
+    // Данные для медленного пути
+    fill(table.lengthCount, table.lengthCount + MAX_CODE_LENGTH + 1, 0);
+    table.maxLength = 0;
+    for (int c = 0; c < 256; c++) {
+        table.codeLengths[c] = lengths[c];
+        table.lengthCount[lengths[c]]++;
+        table.maxLength = max(table.maxLength, (int)lengths[c]);
+    }
+    int index = 0;
+    for (int length = 1; length <= MAX_CODE_LENGTH; length++) {
+        table.firstIndex[length] = index;
+        table.firstCode[length] = 0;
+        for (int c = 0; c < 256; c++) {
+            if (lengths[c] == length) {
+                if (index == table.firstIndex[length]) table.firstCode[length] = code.codes[c];
+                table.sortedSymbols[index++] = (uint8_t)c;
+            }
+        }
+    }
+
+    // Сначала по одному символу: код длины L занимает 2^(11 - L) подряд идущих записей
+    for (int i = 0; i < SIZE; i++) table.entries[i] = DecodeEntry{{0, 0}, 0, 0};
+    for (int c = 0; c < 256; c++) {
+        int length = lengths[c];
+        if (length == 0 || length > DECODE_TABLE_BITS) continue;
+        int first = (int)(code.codes[c] << (DECODE_TABLE_BITS - length));
+        for (int i = first; i < first + (1 << (DECODE_TABLE_BITS - length)); i++) {
+            table.entries[i] = DecodeEntry{{(uint8_t)c, 0}, (uint8_t)length, 1};
+        }
+    }
+
+    // Затем второй символ: если оставшиеся биты записи целиком содержат еще один код, дописываем его
+    for (int i = 0; i < SIZE; i++) {
+        DecodeEntry& entry = table.entries[i];
+        if (entry.count == 0) continue;
+        int length = lengths[entry.symbol[0]];
+        const DecodeEntry& next = table.entries[(i << length) & (SIZE - 1)];  // Первый символ - по коду
+        int nextLength = next.count == 0 ? 0 : lengths[next.symbol[0]];
+        if (nextLength != 0 && nextLength <= DECODE_TABLE_BITS - length) {
+            entry.symbol[1] = next.symbol[0];
+            entry.bits = (uint8_t)(length + nextLength);
+            entry.count = 2;
+        }
+    }
+}
+
+// Медленный путь: код длиннее таблицы ищем по длинам канонически; -1 - такого кода нет
+inline int decodeLongSymbol(const DecodeTable& table, BitReader& reader) {
+    for (int length = DECODE_TABLE_BITS + 1; length <= table.maxLength; length++) {
+        uint64_t offset = reader.peek(length) - table.firstCode[length];
+        if (offset < (uint64_t)table.lengthCount[length]) {
+            reader.consume(length);
+            return table.sortedSymbols[table.firstIndex[length] + offset];
+        }
+    }
+    return -1;
+}
+
+// Декодирует символы out[produced, length) одного потока
+// За один поиск в таблице обычно получается один-два символа, длинные коды идут медленным путем
+bool decodeStream(const DecodeTable& table, BitReader& reader, char* out, uint64_t produced, uint64_t length) {
+    // Основной цикл: до конца текста не меньше 8 символов, поэтому проверки границ не нужны
+    while (length - produced >= 8) {
+        reader.refill();  // После дополнения в буфере >= 56 бит - хватит на 4 поиска по 11 бит
+        for (int step = 0; step < 4; step++) {  // Каждый поиск дает 1-2 символа
+            DecodeEntry entry = table.entries[reader.peek(DECODE_TABLE_BITS)];
+            if (entry.count == 0) {
+                int symbol = decodeLongSymbol(table, reader);
+                if (symbol < 0) return false;
+                out[produced++] = (char)symbol;
+                break;  // Длинный код мог съесть почти весь буфер - дополняем заново
+            }
+            out[produced] = (char)entry.symbol[0];
+            out[produced + 1] = (char)entry.symbol[1];
+            reader.consume(entry.bits);
+            produced += entry.count;
+        }
+    }
+
+    // Последние символы: второй символ записи берем, только если текст еще не закончился
+    // (и не пишем его за конец - там может начинаться уже декодированная часть другого потока)
+    while (produced < length) {
+        reader.refill();
+        for (int step = 0; step < 4 && produced < length; step++) {
+            DecodeEntry entry = table.entries[reader.peek(DECODE_TABLE_BITS)];
+            if (entry.count == 0) {
+                int symbol = decodeLongSymbol(table, reader);
+                if (symbol < 0) return false;
+                out[produced++] = (char)symbol;
+                break;  // Длинный код мог съесть почти весь буфер - дополняем заново
+            }
+            out[produced] = (char)entry.symbol[0];
+            if (entry.count == 2 && produced + 1 < length) {
+                out[produced + 1] = (char)entry.symbol[1];
+                reader.consume(entry.bits);
+                produced += 2;
+            } else {
+                reader.consume(table.codeLengths[entry.symbol[0]]);
+                produced += 1;
+            }
+        }
+    }
+    return true;
+}
+
+// Время этапов распаковки, секунды (накапливается по блокам)
+struct DecompressStageTimes {
+    double header = 0;    // Заголовок кодов
+    double table = 0;     // Таблица декодирования
+    double decode = 0;    // Декодирование (для блоков без кода - копирование)
+    double checksum = 0;  // CRC32
+};
+
+// Замер этапов: finish(&Times::x) прибавляет к x время с предыдущей отсечки; без times ничего не делает
+template <typename Times>
+class StageClock {
+public:
+    explicit StageClock(Times* stageTimes) : times(stageTimes), start(chrono::steady_clock::now()) {}
+
+    void finish(double Times::*stage) {
+        if (!times) return;
+        auto now = chrono::steady_clock::now();
+        times->*stage += chrono::duration<double>(now - start).count();
+        start = now;
+    }
+
+    // Пропустить время с предыдущей отсечки (его уже учел кто-то другой)
+    void skip() {
+        if (times) start = chrono::steady_clock::now();
+    }
+
+private:
+    Times* times;
+    chrono::steady_clock::time_point start;
+};
+
+// Декодирует данные encodeString(); false - данные испорчены
+// times - если задано, к нему прибавляется время этапов
+bool decodeString(const vector<uint8_t>& encoded, string& text, DecompressStageTimes* times = nullptr) {
+    StageClock<DecompressStageTimes> clock(times);
+    const uint8_t* pos = encoded.data();
+    const uint8_t* end = pos + encoded.size();
+    uint64_t textLength;
+    uint8_t lengths[256];
+    if (!readCodeHeader(pos, end, textLength, lengths)) return false;
+    if (textLength == 0) {
+        text.clear();
+        return true;
+    }
+    if (textLength > (uint64_t)(end - pos) * 8) return false;  // Каждый символ занимает хотя бы бит
+    text.resize(textLength);  // Повторно используемая строка нужного размера не заполняется заново
+    clock.finish(&DecompressStageTimes::header);
+
+    DecodeTable table;
+    buildDecodeTable(lengths, table);
+    clock.finish(&DecompressStageTimes::table);
+    BitReader reader(pos, end);
+    bool decoded = decodeStream(table, reader, &text[0], 0, textLength) &&
+                   !reader.overrun();  // Поток кончился раньше текста - данные испорчены
+    clock.finish(&DecompressStageTimes::decode);
+    return decoded;
+}
+
+// Декодирует данные encodeString4(); false - данные испорчены
+// times - если задано, к нему прибавляется время этапов
+bool decodeString4(const vector<uint8_t>& encoded, string& text, DecompressStageTimes* times = nullptr) {
+    StageClock<DecompressStageTimes> clock(times);
+    const uint8_t* pos = encoded.data();
+    const uint8_t* end = pos + encoded.size();
+    uint64_t textLength;
+    uint8_t lengths[256];
+    if (!readCodeHeader(pos, end, textLength, lengths)) return false;
+    if (textLength == 0) {
+        text.clear();
+        return true;
+    }
+    if ((size_t)(end - pos) < STREAM_JUMP_TABLE_SIZE) return false;
+    const uint8_t* streamStart[STREAM_COUNT + 1];  // Границы потоков; последняя - конец данных
+    streamStart[0] = pos + STREAM_JUMP_TABLE_SIZE;
+    for (int stream = 0; stream < STREAM_COUNT - 1; stream++) {
+        uint32_t size = readU32(pos + 4 * stream);
+        if (size > (size_t)(end - streamStart[stream])) return false;
+        streamStart[stream + 1] = streamStart[stream] + size;
+    }
+    streamStart[STREAM_COUNT] = end;
+    if (textLength > (uint64_t)(end - streamStart[0]) * 8) return false;  // Каждый символ занимает хотя бы бит
+    text.resize(textLength);
+    clock.finish(&DecompressStageTimes::header);
+
+    DecodeTable table;
+    buildDecodeTable(lengths, table);
+    clock.finish(&DecompressStageTimes::table);
+    uint64_t segment = streamSegmentLength(textLength);
+    BitReader readers[STREAM_COUNT] = {
+        {streamStart[0], streamStart[1]}, {streamStart[1], streamStart[2]},
+        {streamStart[2], streamStart[3]}, {streamStart[3], streamStart[4]}};
+    char* out[STREAM_COUNT];
+    uint64_t produced[STREAM_COUNT] = {};
+    uint64_t length[STREAM_COUNT];
+    for (int stream = 0; stream < STREAM_COUNT; stream++) {
+        uint64_t first = min(textLength, stream * segment);
+        length[stream] = stream == STREAM_COUNT - 1 ? textLength - first : min(segment, textLength - first);
+        out[stream] = &text[0] + first;
+    }
+
+    // Общий цикл для всех потоков, пока в каждом до конца не меньше 8 символов;
+    // только если все коды помещаются в таблицу (при ограничении длины кода по умолчанию - всегда)
+    if (table.maxLength <= DECODE_TABLE_BITS) {
+        auto enoughLeft = [&] {
+            for (int stream = 0; stream < STREAM_COUNT; stream++) {
+                if (length[stream] - produced[stream] < 8) return false;
+            }
+            return true;
+        };
+        bool valid = true;  // false - встретилась незанятая запись таблицы (неполный код в испорченных данных)
+        while (valid && enoughLeft()) {
+            for (int stream = 0; stream < STREAM_COUNT; stream++) readers[stream].refill();
+            for (int step = 0; step < 4 && valid; step++) {
+                for (int stream = 0; stream < STREAM_COUNT; stream++) {  // Четыре независимые цепочки
+                    DecodeEntry entry = table.entries[readers[stream].peek(DECODE_TABLE_BITS)];
+                    if (entry.count == 0) {  // Без этой проверки цикл стоял бы на месте; отказ - в decodeStream
+                        valid = false;
+                        break;
+                    }
+                    out[stream][produced[stream]] = (char)entry.symbol[0];
+                    out[stream][produced[stream] + 1] = (char)entry.symbol[1];
+                    readers[stream].consume(entry.bits);
+                    produced[stream] += entry.count;
+                }
+            }
+        }
+    }
+
+    // Остаток каждого потока (или весь поток, если есть длинные коды) - по одному
+    for (int stream = 0; stream < STREAM_COUNT; stream++) {
+        if (!decodeStream(table, readers[stream], out[stream], produced[stream], length[stream]) ||
+            readers[stream].overrun()) {
+            return false;
+        }
+    }
+    clock.finish(&DecompressStageTimes::decode);
+    return true;
+}
+
+// Канонический код по частотам: дерево -> длины кодов (не длиннее maxLength) -> коды
+CanonicalCode buildCodeForHistogram(const Histogram& histogram, int maxLength) {
+    uint8_t lengths[256];
+    buildCodeLengths(histogram, maxLength, lengths);
+    return buildCanonicalCode(lengths);
+}
+
+// Канонический код для текста: частоты -> дерево -> длины кодов (не длиннее maxLength) -> коды
+CanonicalCode buildCodeForText(const string& text, int maxLength = DEFAULT_CODE_LENGTH_LIMIT) {
+    CanonicalCode code;
+    if (text.empty()) return code;
+    return buildCodeForHistogram(calculateFrequencies(text), maxLength);
+}
+
+// ===== Адаптивный код Хаффмана (FGK): дерево обновляется после каждого символа =====
+//
+// Кодер и декодер начинают с одинакового дерева из одного узла NYT ("еще не встречался") и после
+// каждого символа одинаково его перестраивают, поэтому таблица кодов не передается и предварительный
+// подсчет частот не нужен: биты символа уходят сразу, как только символ пришел.
+// Новый символ передается кодом NYT и 9 битами значения; значение 256 - конец потока.
+// Формат: "HUFA", затем битовый поток (последний байт дополнен нулями).
+
+const char ADAPTIVE_MAGIC[4] = {'H', 'U', 'F', 'A'};
+const int ADAPTIVE_END_OF_STREAM = 256;
+const int ADAPTIVE_SYMBOL_BITS = 9;         // 256 значений байта + конец потока
+const int ADAPTIVE_MAX_NODES = 2 * 257 - 1; // 256 листьев + NYT и внутренние узлы между ними
+
+// Дерево адаптивного кода. Узлы лежат в массиве по порядковым номерам: веса не убывают с номером,
+// а братья идут подряд (свойство братства); корень - последний элемент, новые узлы занимают места ниже
+struct AdaptiveHuffman {
+    Node nodes[ADAPTIVE_MAX_NODES];    // frequency - вес узла, character - символ листа
+    int parent[ADAPTIVE_MAX_NODES];    // Родитель узла с данным номером (-1 у корня)
+    int leafOf[256];                   // Номер листа символа, -1 - символ еще не встречался
+    int nyt = ADAPTIVE_MAX_NODES - 1;  // Номер узла NYT; сначала он же корень
+
+    AdaptiveHuffman() {
+        nodes[nyt] = {0, -1, -1, 0};
+        parent[nyt] = -1;
+        fill(leafOf, leafOf + 256, -1);
+    }
+
+    // Записывает код символа (0..255 или ADAPTIVE_END_OF_STREAM) и обновляет дерево
+    void encode(int symbol, BitWriter& writer) {
+        int leaf = symbol < 256 ? leafOf[symbol] : -1;
+        writePath(leaf >= 0 ? leaf : nyt, writer);
+        if (leaf < 0) writer.put(symbol, ADAPTIVE_SYMBOL_BITS);  // Новый символ - значением после NYT
+        if (symbol < 256) update(symbol);
+    }
+
+    // Читает один символ; readBit() возвращает 0, 1 или -1 (данные кончились)
+    // Возвращает символ, ADAPTIVE_END_OF_STREAM или -1, если данные испорчены или оборваны
+    template <typename ReadBit>
+    int decode(ReadBit readBit) {
+        int node = ADAPTIVE_MAX_NODES - 1;
+        while (nodes[node].left >= 0) {  // Спускаемся от корня до листа
+            int bit = readBit();
+            if (bit < 0) return -1;
+            node = bit ? nodes[node].right : nodes[node].left;
+        }
+        int symbol = nodes[node].character;
+        if (node == nyt) {
+            symbol = 0;
+            for (int i = 0; i < ADAPTIVE_SYMBOL_BITS; i++) {
+                int bit = readBit();
+                if (bit < 0) return -1;
+                symbol = (symbol << 1) | bit;
+            }
+            if (symbol == ADAPTIVE_END_OF_STREAM) return symbol;
+            if (symbol > ADAPTIVE_END_OF_STREAM || leafOf[symbol] >= 0) return -1;  // Через NYT - только новые
+        }
+        update(symbol);
+        return symbol;
+    }
+
+private:
+    // Путь от корня до узла: биты собираются снизу вверх, а записываются сверху вниз
+    void writePath(int node, BitWriter& writer) {
+        uint8_t bits[ADAPTIVE_MAX_NODES];
+        int depth = 0;
+        for (; parent[node] >= 0; node = parent[node]) {
+            bits[depth++] = nodes[parent[node]].right == node;
+        }
+        while (depth > 0) {  // Кусками до 32 бит
+            int chunk = min(depth, 32);
+            uint64_t code = 0;
+            for (int i = 0; i < chunk; i++) code = (code << 1) | bits[--depth];
+            writer.put(code, chunk);
+        }
+    }
+
+    // После перемещения содержимого узла на место index исправляет ссылки на него
+    void relink(int index) {
+        if (nodes[index].left >= 0) {
+            parent[nodes[index].left] = index;
+            parent[nodes[index].right] = index;
+        } else if (index != nyt) {
+            leafOf[nodes[index].character] = index;
+        }
+    }
+
+    // Меняет местами два поддерева (место в дереве остается за номером, содержимое переезжает)
+    void swapNodes(int a, int b) {
+        swap(nodes[a], nodes[b]);
+        if (nyt == a) {
+            nyt = b;
+        } else if (nyt == b) {
+            nyt = a;
+        }
+        relink(a);
+        relink(b);
+    }
+
+    // Увеличивает вес символа, сохраняя свойство братства (алгоритм FGK)
+    void update(int symbol) {
+        int node = leafOf[symbol];
+        if (node < 0) {  // Новый символ: NYT становится внутренним узлом с детьми NYT и листом символа
+            int split = nyt;
+            nodes[split].left = split - 2;
+            nodes[split].right = split - 1;
+            nodes[split - 1] = {0, -1, -1, (unsigned char)symbol};
+            nodes[split - 2] = {0, -1, -1, 0};
+            parent[split - 1] = parent[split - 2] = split;
+            leafOf[symbol] = split - 1;
+            nyt = split - 2;
+            node = split - 1;
+        }
+        while (node >= 0) {
+            // Перед увеличением узел встает на место старшего узла с тем же весом (но не своего родителя)
+            int leader = node;
+            while (leader + 1 < ADAPTIVE_MAX_NODES && nodes[leader + 1].frequency == nodes[node].frequency) leader++;
+            if (leader == parent[node]) leader--;
+            if (leader != node) {
+                swapNodes(node, leader);
+                node = leader;
+            }
+            nodes[node].frequency++;
+            node = parent[node];
+        }
+    }
+};
+
+const size_t ADAPTIVE_CHUNK_SIZE = 4096;  // Готовые байты забираются из буфера кусками такого размера
+// Код одного символа: путь от корня (не длиннее числа узлов) и 9 бит значения
+const size_t ADAPTIVE_MAX_CODE_BYTES = (ADAPTIVE_MAX_NODES + ADAPTIVE_SYMBOL_BITS) / 8 + 1;
+
+// Выход адаптивного кодера: BitWriter пишет в буфер фиксированного размера, готовые байты забираются кусками
+struct AdaptiveChunk {
+    uint8_t bytes[ADAPTIVE_CHUNK_SIZE + ADAPTIVE_MAX_CODE_BYTES + BIT_WRITER_SLACK];
+    BitWriter writer{bytes};
+
+    size_t ready() const { return writer.out - bytes; }  // Сколько байт готово
+    bool full() const { return ready() >= ADAPTIVE_CHUNK_SIZE; }
+    void clear() { writer.out = bytes; }  // Неполный байт остается в регистре writer
+};
+
+// Кодирует текст адаптивным кодом целиком в память
+vector<uint8_t> encodeAdaptive(const string& text) {
+    vector<uint8_t> encoded(ADAPTIVE_MAGIC, ADAPTIVE_MAGIC + 4);
+    AdaptiveHuffman model;
+    AdaptiveChunk chunk;
+    for (unsigned char ch : text) {
+        model.encode(ch, chunk.writer);
+        if (chunk.full()) {
+            encoded.insert(encoded.end(), chunk.bytes, chunk.bytes + chunk.ready());
+            chunk.clear();
+        }
+    }
+    model.encode(ADAPTIVE_END_OF_STREAM, chunk.writer);
+    chunk.writer.flush();
+    encoded.insert(encoded.end(), chunk.bytes, chunk.bytes + chunk.ready());
+    return encoded;
+}
+
+// Декодирует данные encodeAdaptive(); false - данные испорчены
+bool decodeAdaptive(const vector<uint8_t>& encoded, string& text) {
+    if (encoded.size() < 4 || memcmp(encoded.data(), ADAPTIVE_MAGIC, 4) != 0) return false;
+    size_t bitPos = 32;
+    auto readBit = [&]() -> int {
+        if (bitPos >= encoded.size() * 8) return -1;
+        int bit = (encoded[bitPos >> 3] >> (7 - (bitPos & 7))) & 1;
+        bitPos++;
+        return bit;
+    };
+    AdaptiveHuffman model;
+    text.clear();
+    while (true) {
+        int symbol = model.decode(readBit);
+        if (symbol < 0) return false;
+        if (symbol == ADAPTIVE_END_OF_STREAM) return true;
+        text += (char)symbol;
+    }
+}
+
+// Открывает файл; "-" - стандартный ввод или вывод
+FILE* openStream(const string& name, bool forWriting) {
+    if (name == "-") return forWriting ? stdout : stdin;
+    return fopen(name.c_str(), forWriting ? "wb" : "rb");
+}
+
+void closeStream(FILE* file) {
+    if (file != stdin && file != stdout) fclose(file);
+}
+
+// Потоковое адаптивное сжатие: каждая строка входа уходит в выход сразу (с точностью до неполного байта),
+// не дожидаясь конца данных - для телеметрии и других непрерывных каналов
+bool compressAdaptive(const string& inputName, const string& outputName) {
+    FILE* input = openStream(inputName, false);
+    FILE* output = input ? openStream(outputName, true) : nullptr;
+    if (!input || !output) {
+        cerr << "Ошибка: не удалось открыть " << (input ? outputName : inputName) << endl;
+        if (input) closeStream(input);
+        return false;
+    }
+    AdaptiveHuffman model;
+    AdaptiveChunk chunk;  // Готовые байты, еще не записанные
+    bool ok = fwrite(ADAPTIVE_MAGIC, 1, 4, output) == 4;
+    int ch;
+    while (ok && (ch = getc(input)) != EOF) {
+        model.encode(ch, chunk.writer);
+        if (ch == '\n' || chunk.full()) {
+            ok = fwrite(chunk.bytes, 1, chunk.ready(), output) == chunk.ready() && fflush(output) == 0;
+            chunk.clear();
+        }
+    }
+    model.encode(ADAPTIVE_END_OF_STREAM, chunk.writer);
+    chunk.writer.flush();
+    ok = ok && !ferror(input) && fwrite(chunk.bytes, 1, chunk.ready(), output) == chunk.ready() &&
+         fflush(output) == 0;
+    closeStream(input);
+    closeStream(output);
+    if (!ok) cerr << "Ошибка при адаптивном сжатии " << inputName << endl;
+    return ok;
+}
+
+// Потоковая распаковка compressAdaptive(): символы выводятся по мере поступления битов
+bool decompressAdaptive(const string& inputName, const string& outputName) {
+    FILE* input = openStream(inputName, false);
+    FILE* output = input ? openStream(outputName, true) : nullptr;
+    if (!input || !output) {
+        cerr << "Ошибка: не удалось открыть " << (input ? outputName : inputName) << endl;
+        if (input) closeStream(input);
+        return false;
+    }
+    char magic[4];
+    bool ok = fread(magic, 1, 4, input) == 4 && memcmp(magic, ADAPTIVE_MAGIC, 4) == 0;
+    int byte = 0, bitsLeft = 0;
+    auto readBit = [&]() -> int {
+        if (bitsLeft == 0) {
+            byte = getc(input);
+            if (byte == EOF) return -1;
+            bitsLeft = 8;
+        }
+        return (byte >> --bitsLeft) & 1;
+    };
+    AdaptiveHuffman model;
+    while (ok) {
+        int symbol = model.decode(readBit);
+        if (symbol < 0 || symbol == ADAPTIVE_END_OF_STREAM) {
+            ok = symbol == ADAPTIVE_END_OF_STREAM;
+            break;
+        }
+        ok = putc(symbol, output) != EOF && (symbol != '\n' || fflush(output) == 0);
+    }
+    ok = fflush(output) == 0 && ok;
+    closeStream(input);
+    closeStream(output);
+    if (!ok) cerr << "Ошибка: " << inputName << " поврежден или не является адаптивно сжатым файлом" << endl;
+    return ok;
+}
+
+// ===== Потоковый режим: сжатие файла независимыми блоками =====
+//
+// Формат контейнера (все числа - little-endian):
+//   заголовок файла: "HUF1", версия (1 байт), размер блока (4 байта)
+//   блоки подряд:    размер исходных данных (4), размер сжатых данных (4), CRC32 исходных данных (4),
+//                    тип блока (1), данные блока - по типу: вывод encodeString или encodeString4 (свои
+//                    длины кодов у каждого блока), исходные байты или единственный повторяющийся байт
+//   конец:           блок с размером исходных данных 0
+//   индекс блоков:   для каждого блока смещение (8), размер блока в файле (4), размер исходных данных (4)
+//   концевик:        число блоков (8), смещение индекса (8), "HUFI"
+// Каждый блок кодируется по своей таблице частот, поэтому память ограничена размером блока,
+// а по индексу блоки можно читать и распаковывать независимо (и параллельно)
+
+const char CONTAINER_MAGIC[4] = {'H', 'U', 'F', '1'};
+const uint8_t CONTAINER_VERSION = 2;       // 2 - с индексом блоков в конце файла
+const size_t CONTAINER_HEADER_SIZE = 9;    // Сигнатура + версия + размер блока
+const size_t BLOCK_HEADER_SIZE = 13;       // Два размера + CRC32 + тип
+const size_t BLOCK_INDEX_ENTRY_SIZE = 16;  // Смещение + размер в файле + исходный размер
+const size_t CONTAINER_TRAILER_SIZE = 20;  // Число блоков + смещение индекса + сигнатура
+const char INDEX_MAGIC[4] = {'H', 'U', 'F', 'I'};
+const size_t DEFAULT_BLOCK_SIZE = 128 * 1024;
+const size_t MAX_BLOCK_SIZE = 64 * 1024 * 1024;  // Ограничение, чтобы испорченный заголовок не заставил выделить гигабайты
+
+// Способ хранения блока
+enum BlockType : uint8_t {
+    BLOCK_HUFFMAN = 1,          // Канонический код Хаффмана (encodeString)
+    BLOCK_HUFFMAN_4STREAMS = 2, // Тот же код в четырех потоках (encodeString4)
+    BLOCK_STORED = 3,           // Без сжатия: данные как есть (несжимаемые данные)
+    BLOCK_SINGLE_SYMBOL = 4,    // Весь блок - один повторяющийся байт; данные - этот байт
+};
+
+// Таблицы CRC32 (полином 0xEDB88320, как в zip и gzip) для обработки по 8 байт (slicing-by-8):
+// values[k][b] - вклад байта b, за которым следуют еще k байт
+struct Crc32Table {
+    uint32_t values[8][256];
+    Crc32Table() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+            }
+            values[0][i] = crc;
+        }
+        for (int k = 1; k < 8; k++) {
+            for (int i = 0; i < 256; i++) {
+                values[k][i] = (values[k - 1][i] >> 8) ^ values[0][values[k - 1][i] & 0xFF];
+            }
+        }
+    }
+};
+
+// Контрольная сумма CRC32 блока данных
+uint32_t crc32(const uint8_t* data, size_t size) {
+    static const Crc32Table table;
+    uint32_t crc = 0xFFFFFFFFu;
+    size_t i = 0;
+    // По 8 байт: восемь независимых поисков вместо цепочки из восьми зависимых (порядок байт little-endian)
+    for (; i + 8 <= size; i += 8) {
+        uint32_t low = readU32(data + i) ^ crc;
+        uint32_t high = readU32(data + i + 4);
+        crc = table.values[7][low & 0xFF] ^ table.values[6][(low >> 8) & 0xFF] ^
+              table.values[5][(low >> 16) & 0xFF] ^ table.values[4][low >> 24] ^
+              table.values[3][high & 0xFF] ^ table.values[2][(high >> 8) & 0xFF] ^
+              table.values[1][(high >> 16) & 0xFF] ^ table.values[0][high >> 24];
+    }
+    for (; i < size; i++) {
+        crc = table.values[0][(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+// Оценка снизу размера данных в байтах после кода Хаффмана: энтропия Шеннона на символ, умноженная на их число
+// (код Хаффмана тратит на символ не меньше энтропии и не больше энтропии + 1 бит)
+double entropyBytes(const Histogram& histogram, uint64_t total) {
+    double bits = 0;
+    for (int c = 0; c < 256; c++) {
+        if (histogram.counts[c] > 0) {
+            bits -= histogram.counts[c] * log2((double)histogram.counts[c] / total);
+        }
+    }
+    return bits / 8;
+}
+
+// Выбирает способ хранения блока по гистограмме, до построения дерева:
+// один символ - BLOCK_SINGLE_SYMBOL, если даже оценка снизу для кода Хаффмана (энтропия + заголовок кодов)
+// не меньше исходного размера - BLOCK_STORED, иначе BLOCK_HUFFMAN
+BlockType chooseBlockType(const Histogram& histogram, size_t size) {
+    int used = 0;
+    for (int c = 0; c < 256; c++) {
+        if (histogram.counts[c] > 0) used++;
+    }
+    if (used == 1) return BLOCK_SINGLE_SYMBOL;
+    // Заголовок кодов: пара байт на символ, varint длины, число символов и таблица переходов
+    double headerBytes = 2.0 * used + 10 + STREAM_JUMP_TABLE_SIZE;
+    return used == 0 || entropyBytes(histogram, size) + headerBytes >= size ? BLOCK_STORED : BLOCK_HUFFMAN;
+}
+
+// Время этапов сжатия, секунды (накапливается по блокам)
+struct StageTimes {
+    double histogram = 0;  // Подсчет частот и выбор способа хранения
+    double tree = 0;       // Дерево и длины кодов
+    double codegen = 0;    // Канонические коды
+    double encode = 0;     // Кодирование и сборка кадра
+    double checksum = 0;   // CRC32
+};
+
+// Сколько байт нужно под кадр блока из size байт: сжатые данные кладутся в кадр, только если они
+// короче исходных, плюс запас для BitWriter
+inline size_t maxFrameSize(size_t size) {
+    return BLOCK_HEADER_SIZE + size + BIT_WRITER_SLACK;
+}
+
+// Сжимает один блок в кадр контейнера (заголовок блока + сжатые данные) прямо в frame
+// (maxFrameSize(size) байт) без выделения памяти; возвращает размер кадра
+// streams - 1 или STREAM_COUNT битовых потоков для блоков с кодом Хаффмана;
+// times - если задано, к нему прибавляется время этапов
+size_t compressBlock(const uint8_t* raw, size_t size, int maxCodeLength, int streams, uint8_t* frame,
+                     StageTimes* times = nullptr) {
+    StageClock<StageTimes> clock(times);
+
+    Histogram histogram = calculateFrequencies(raw, size);
+    BlockType type = chooseBlockType(histogram, size);
+    clock.finish(&StageTimes::histogram);
+    uint8_t* data = frame + BLOCK_HEADER_SIZE;
+    size_t dataSize = 0;
+    if (type == BLOCK_HUFFMAN) {
+        uint8_t lengths[256];
+        buildCodeLengths(histogram, maxCodeLength, lengths);
+        clock.finish(&StageTimes::tree);
+        CanonicalCode code = buildCanonicalCode(lengths);
+        clock.finish(&StageTimes::codegen);
+        // Размер кода известен заранее по частотам: если он не окупается (оценка ошиблась), блок хранится как есть
+        if (encodedSizeBound(histogram, size, code, streams) >= size) {
+            type = BLOCK_STORED;
+        } else if (streams == STREAM_COUNT) {
+            type = BLOCK_HUFFMAN_4STREAMS;
+            dataSize = encodeBytes4(raw, size, code, data);
+        } else {
+            dataSize = encodeBytes(raw, size, code, data);
+        }
+    }
+    // Данные блока без кода Хаффмана: исходные байты или единственный байт
+    if (type == BLOCK_STORED) {
+        dataSize = size;
+        memcpy(data, raw, size);
+    } else if (type == BLOCK_SINGLE_SYMBOL) {
+        dataSize = 1;
+        data[0] = raw[0];
+    }
+    writeU32((uint32_t)size, frame);
+    writeU32((uint32_t)dataSize, frame + 4);
+    frame[12] = type;
+    clock.finish(&StageTimes::encode);
+    writeU32(crc32(raw, size), frame + 8);
+    clock.finish(&StageTimes::checksum);
+    return BLOCK_HEADER_SIZE + dataSize;
+}
+
+// Сжатие блока в новый массив (самопроверка)
+vector<uint8_t> compressBlock(const string& block, int maxCodeLength, int streams) {
+    vector<uint8_t> frame(maxFrameSize(block.size()));
+    frame.resize(compressBlock((const uint8_t*)block.data(), block.size(), maxCodeLength, streams, frame.data()));
+    return frame;
+}
+
+// Разбирает заголовок блока; false - заголовок испорчен
+bool readBlockHeader(const uint8_t* header, size_t blockSize, uint32_t& rawSize, uint32_t& payloadSize,
+                     uint32_t& checksum, uint8_t& type) {
+    rawSize = readU32(header);
+    payloadSize = readU32(header + 4);
+    checksum = readU32(header + 8);
+    type = header[12];
+    // Сжатые данные не длиннее исходных больше чем на заголовок кодов (256 пар), varint и таблицу переходов
+    return rawSize <= blockSize && payloadSize <= (uint64_t)rawSize * 7 + 1024 &&
+           type >= BLOCK_HUFFMAN && type <= BLOCK_SINGLE_SYMBOL;
+}
+
+// Восстанавливает блок по сжатым данным и проверяет размер и контрольную сумму
+// times - если задано, к нему прибавляется время этапов
+bool decompressBlock(const vector<uint8_t>& payload, uint8_t type, uint32_t rawSize, uint32_t checksum, string& block,
+                     DecompressStageTimes* times = nullptr) {
+    StageClock<DecompressStageTimes> clock(times);
+    bool decoded;
+    if (type == BLOCK_STORED) {
+        decoded = payload.size() == rawSize;
+        if (decoded) block.assign(payload.begin(), payload.end());
+        clock.finish(&DecompressStageTimes::decode);
+    } else if (type == BLOCK_SINGLE_SYMBOL) {
+        decoded = payload.size() == 1;
+        if (decoded) block.assign(rawSize, (char)payload[0]);
+        clock.finish(&DecompressStageTimes::decode);
+    } else {
+        decoded = type == BLOCK_HUFFMAN_4STREAMS ? decodeString4(payload, block, times)
+                                                 : decodeString(payload, block, times);
+        clock.skip();  // Этапы уже учтены при декодировании
+    }
+    if (!decoded || block.size() != rawSize) return false;
+    bool valid = crc32((const uint8_t*)block.data(), block.size()) == checksum;
+    clock.finish(&DecompressStageTimes::checksum);
+    return valid;
+}
+
+/**
+ * Конвейер обработки блоков: поток чтения, threadCount рабочих потоков и запись в исходном порядке
+ *
+ * read(task, end) читает очередной блок (end = true - данных больше нет), process(task)
+ * обрабатывает блок в рабочем потоке, write(task) вызывается в вызывающем потоке строго
+ * в порядке чтения. Одновременно в памяти не больше 2 * threadCount + 1 блоков.
+ * Любая стадия, вернувшая false, останавливает конвейер.
+ */
+template <typename Task>
+bool runBlockPipeline(size_t threadCount, function<bool(Task&, bool&)> read,
+                      function<bool(Task&)> process, function<bool(Task&)> write) {
+    mutex lockMutex;
+    condition_variable changed;       // Любое изменение состояния конвейера
+    deque<pair<uint64_t, Task>> queued;  // Прочитаны, ждут обработки: (номер, блок)
+    map<uint64_t, Task> processed;    // Обработаны, ждут записи по порядку
+    const size_t maxInFlight = 2 * threadCount + 1;
+    size_t inFlight = 0;              // Прочитано, но еще не записано
+    uint64_t readCount = 0;           // Сколько блоков прочитано всего
+    bool readFinished = false;
+    bool failed = false;
+
+    thread reader([&] {
+        while (true) {
+            {
+                unique_lock<mutex> lock(lockMutex);
+                changed.wait(lock, [&] { return inFlight < maxInFlight || failed; });
+                if (failed) return;
+            }
+            Task task;
+            bool end = false;
+            bool ok = read(task, end);
+            lock_guard<mutex> lock(lockMutex);
+            if (!ok || end) {
+                failed = failed || !ok;
+                readFinished = true;
+                changed.notify_all();
+                return;
+            }
+            queued.emplace_back(readCount++, move(task));
+            inFlight++;
+            changed.notify_all();
+        }
+    });
+
+    vector<thread> workers;
+    for (size_t t = 0; t < threadCount; t++) {
+        workers.emplace_back([&] {
+            while (true) {
+                unique_lock<mutex> lock(lockMutex);
+                changed.wait(lock, [&] { return !queued.empty() || readFinished || failed; });
+                if (failed || queued.empty()) return;
+                pair<uint64_t, Task> item = move(queued.front());
+                queued.pop_front();
+                lock.unlock();
+
+                bool ok = process(item.second);
+                lock.lock();
+                if (ok) {
+                    processed.emplace(item.first, move(item.second));
+                } else {
+                    failed = true;
+                }
+                changed.notify_all();
+            }
+        });
+    }
+
+    // Запись: ждем блок со следующим номером, пока не записаны все прочитанные
+    for (uint64_t next = 0;; next++) {
+        unique_lock<mutex> lock(lockMutex);
+        changed.wait(lock, [&] { return processed.count(next) || failed || (readFinished && next == readCount); });
+        if (failed || !processed.count(next)) break;
+        Task task = move(processed[next]);
+        processed.erase(next);
+        lock.unlock();
+
+        bool ok = write(task);
+        lock.lock();
+        inFlight--;
+        failed = failed || !ok;
+        changed.notify_all();
+    }
+
+    reader.join();
+    for (auto& worker : workers) worker.join();
+    return !failed;
+}
+
+// Запись индекса: где лежит блок и сколько он занимает
+struct BlockIndexEntry {
+    uint64_t offset;     // Смещение заголовка блока от начала файла
+    uint32_t frameSize;  // Заголовок блока + сжатые данные
+    uint32_t rawSize;    // Размер исходных данных
+};
+
+// Входной файл сжатия, отображенный в память (mmap): подсчет частот и кодирование читают байты прямо
+// из страничного кэша без копий. Отобразить можно только обычный файл; каналы, устройства и стандартный
+// ввод (и все файлы там, где mmap нет) сжимаются потоком блоков (compressStream) в ограниченной памяти
+struct InputFile {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+
+    InputFile() = default;
+    InputFile(const InputFile&) = delete;
+    InputFile& operator=(const InputFile&) = delete;
+
+    // false - файл не удалось открыть или он не отображается в память
+    bool map(const string& name) {
+#ifdef HUFFMAN_HAS_MMAP
+        if (name == "-") return false;
+        int fd = ::open(name.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat info;
+        bool mapped = fstat(fd, &info) == 0 && S_ISREG(info.st_mode);
+        if (mapped && info.st_size > 0) {  // Пустой файл не отображается, но и читать в нем нечего
+            void* address = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            mapped = address != MAP_FAILED;
+            if (mapped) {
+                madvise(address, (size_t)info.st_size, MADV_SEQUENTIAL);  // Файл читается один раз подряд
+                mapping = address;
+                data = (const uint8_t*)address;
+                size = (size_t)info.st_size;
+            }
+        }
+        close(fd);
+        return mapped;
+#else
+        (void)name;
+        return false;
+#endif
+    }
+
+    ~InputFile() {
+#ifdef HUFFMAN_HAS_MMAP
+        if (mapping) munmap(mapping, size);
+#endif
+    }
+
+private:
+    void* mapping = nullptr;  // Адрес отображения
+};
+
+// Записывает файл целиком одним вызовом write (повторяется только при частичной записи)
+bool writeWholeFile(const string& name, const uint8_t* data, size_t size) {
+#ifdef HUFFMAN_HAS_MMAP
+    int fd = ::open(name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    bool ok = true;
+    while (ok && size > 0) {
+        ssize_t written = write(fd, data, size);
+        ok = written > 0;
+        if (ok) {
+            data += written;
+            size -= (size_t)written;
+        }
+    }
+    return close(fd) == 0 && ok;
+#else
+    FILE* output = fopen(name.c_str(), "wb");
+    if (!output) return false;
+    bool ok = fwrite(data, 1, size, output) == size;
+    return fclose(output) == 0 && ok;
+#endif
+}
+
+// Наибольший размер контейнера для size байт данных: каждый блок не длиннее maxFrameSize,
+// плюс заголовок, блок конца данных, индекс и концевик
+size_t maxCompressedSize(size_t size, size_t blockSize) {
+    size_t blocks = (size + blockSize - 1) / blockSize;
+    return CONTAINER_HEADER_SIZE + blocks * (maxFrameSize(blockSize) + BLOCK_INDEX_ENTRY_SIZE) + BLOCK_HEADER_SIZE +
+           CONTAINER_TRAILER_SIZE;
+}
+
+/**
+ * Сжимает data[0, size) в контейнер в out (maxCompressedSize(size, blockSize) байт) в threadCount потоках
+ *
+ * Блок i сжимается в свое место out[CONTAINER_HEADER_SIZE + i * maxFrameSize(blockSize)], поэтому потоки
+ * не синхронизируются и память не выделяется; затем кадры сдвигаются вплотную друг к другу по порядку.
+ * Результат побайтно одинаков при любом числе потоков. typeCount[t] - сколько блоков типа t;
+ * times - если задано, к нему прибавляется время этапов (сумма по потокам). Возвращает размер контейнера.
+ */
+size_t compressBuffer(const uint8_t* data, size_t size, uint8_t* out, size_t blockSize, size_t threadCount,
+                      int maxCodeLength, int streams, size_t typeCount[BLOCK_SINGLE_SYMBOL + 1],
+                      StageTimes* times = nullptr) {
+    memcpy(out, CONTAINER_MAGIC, 4);
+    out[4] = CONTAINER_VERSION;
+    writeU32((uint32_t)blockSize, out + 5);
+
+    const size_t blocks = (size + blockSize - 1) / blockSize;
+    const size_t slot = maxFrameSize(blockSize);
+    vector<uint32_t> frameSizes(blocks);
+    vector<StageTimes> threadTimes(max<size_t>(1, min(threadCount, blocks)));
+    atomic<size_t> nextBlock(0);
+    auto work = [&](StageTimes& stages) {
+        while (true) {
+            size_t i = nextBlock++;
+            if (i >= blocks) return;
+            size_t offset = i * blockSize;
+            frameSizes[i] = (uint32_t)compressBlock(data + offset, min(blockSize, size - offset), maxCodeLength,
+                                                    streams, out + CONTAINER_HEADER_SIZE + i * slot,
+                                                    times ? &stages : nullptr);
+        }
+    };
+    vector<thread> workers;
+    for (size_t t = 1; t < threadTimes.size(); t++) {
+        workers.emplace_back(work, ref(threadTimes[t]));
+    }
+    work(threadTimes[0]);  // Вызывающий поток тоже сжимает блоки
+    for (auto& worker : workers) worker.join();
+    for (const StageTimes& stages : threadTimes) {
+        if (!times) break;
+        times->histogram += stages.histogram;
+        times->tree += stages.tree;
+        times->codegen += stages.codegen;
+        times->encode += stages.encode;
+        times->checksum += stages.checksum;
+    }
+
+    // Кадры вплотную: место кадра не раньше его слота, поэтому сдвиг идет только назад и по порядку безопасен
+    uint8_t* end = out + CONTAINER_HEADER_SIZE;
+    for (size_t i = 0; i < blocks; i++) {
+        memmove(end, out + CONTAINER_HEADER_SIZE + i * slot, frameSizes[i]);
+        typeCount[end[12]]++;
+        end += frameSizes[i];
+    }
+
+    // Блок нулевой длины - конец данных, за ним индекс блоков и концевик
+    memset(end, 0, BLOCK_HEADER_SIZE);
+    end[12] = BLOCK_HUFFMAN;
+    end += BLOCK_HEADER_SIZE;
+    uint64_t indexOffset = end - out;
+    uint64_t offset = CONTAINER_HEADER_SIZE;
+    for (size_t i = 0; i < blocks; i++) {
+        writeU64(offset, end);
+        writeU32(frameSizes[i], end + 8);
+        writeU32((uint32_t)min(blockSize, size - i * blockSize), end + 12);
+        offset += frameSizes[i];
+        end += BLOCK_INDEX_ENTRY_SIZE;
+    }
+    writeU64(blocks, end);
+    writeU64(indexOffset, end + 8);
+    memcpy(end + 16, INDEX_MAGIC, 4);
+    return end + CONTAINER_TRAILER_SIZE - out;
+}
+
+// Итоговая строка сжатия файла
+void printCompressSummary(uint64_t totalIn, uint64_t totalOut, size_t blocks,
+                          const size_t typeCount[BLOCK_SINGLE_SYMBOL + 1], size_t threadCount) {
+    cout << "Сжато: " << totalIn << " -> " << totalOut << " байт";
+    if (totalIn > 0) cout << " (" << fixed << setprecision(2) << (double)totalOut / totalIn * 100 << "%)";
+    cout << ", блоков: " << blocks << " (Хаффман " << typeCount[BLOCK_HUFFMAN] + typeCount[BLOCK_HUFFMAN_4STREAMS]
+         << ", без сжатия " << typeCount[BLOCK_STORED] << ", один символ " << typeCount[BLOCK_SINGLE_SYMBOL]
+         << "), потоков: " << threadCount << endl;
+}
+
+/**
+ * Сжатие потоком блоков для входа, который нельзя отобразить в память (канал, устройство, stdin):
+ * поток чтения, threadCount рабочих потоков и запись по порядку (runBlockPipeline), поэтому в памяти
+ * не больше 2 * threadCount + 1 блоков при любом размере входа. Результат тот же, что у compressBuffer.
+ */
+bool compressStream(FILE* input, FILE* output, size_t blockSize, size_t threadCount, int maxCodeLength, int streams,
+                    uint64_t& totalIn, uint64_t& totalOut, size_t typeCount[BLOCK_SINGLE_SYMBOL + 1]) {
+    uint8_t header[CONTAINER_HEADER_SIZE];
+    memcpy(header, CONTAINER_MAGIC, 4);
+    header[4] = CONTAINER_VERSION;
+    writeU32((uint32_t)blockSize, header + 5);
+    bool ok = fwrite(header, 1, sizeof(header), output) == sizeof(header);
+
+    struct Task {
+        vector<uint8_t> raw;    // Исходные данные блока
+        vector<uint8_t> frame;  // Сжатый блок с заголовком
+    };
+    vector<BlockIndexEntry> index;
+    uint64_t offset = sizeof(header);
+    totalIn = 0;
+    ok = ok && runBlockPipeline<Task>(
+        threadCount,
+        [&](Task& task, bool& end) {
+            task.raw.resize(blockSize);
+            task.raw.resize(fread(task.raw.data(), 1, blockSize, input));
+            end = task.raw.empty();
+            return !ferror(input);
+        },
+        [maxCodeLength, streams](Task& task) {
+            task.frame.resize(maxFrameSize(task.raw.size()));
+            task.frame.resize(compressBlock(task.raw.data(), task.raw.size(), maxCodeLength, streams, task.frame.data()));
+            return true;
+        },
+        [&](Task& task) {
+            index.push_back({offset, (uint32_t)task.frame.size(), (uint32_t)task.raw.size()});
+            typeCount[task.frame[12]]++;
+            offset += task.frame.size();
+            totalIn += task.raw.size();
+            return fwrite(task.frame.data(), 1, task.frame.size(), output) == task.frame.size();
+        });
+
+    // Блок нулевой длины - конец данных, за ним индекс блоков и концевик
+    vector<uint8_t> tail(BLOCK_HEADER_SIZE + index.size() * BLOCK_INDEX_ENTRY_SIZE + CONTAINER_TRAILER_SIZE, 0);
+    tail[12] = BLOCK_HUFFMAN;
+    uint8_t* entry = &tail[BLOCK_HEADER_SIZE];
+    for (const BlockIndexEntry& block : index) {
+        writeU64(block.offset, entry);
+        writeU32(block.frameSize, entry + 8);
+        writeU32(block.rawSize, entry + 12);
+        entry += BLOCK_INDEX_ENTRY_SIZE;
+    }
+    writeU64(index.size(), entry);
+    writeU64(offset + BLOCK_HEADER_SIZE, entry + 8);
+    memcpy(entry + 16, INDEX_MAGIC, 4);
+    ok = ok && fwrite(tail.data(), 1, tail.size(), output) == tail.size();
+    totalOut = offset + tail.size();
+    return ok;
+}
+
+// Сжимает файл блоками по blockSize байт в threadCount потоках ("-" - стандартный ввод).
+// Обычный файл отображается в память, контейнер собирается в буфере наибольшего возможного размера
+// и записывается одним вызовом; остальные входы сжимаются потоком (compressStream).
+// Результат побайтно одинаков при любом числе потоков: блоки независимы и пишутся по порядку
+bool compressFile(const string& inputName, const string& outputName, size_t blockSize, size_t threadCount,
+                  int maxCodeLength = DEFAULT_CODE_LENGTH_LIMIT, int streams = STREAM_COUNT) {
+    size_t typeCount[BLOCK_SINGLE_SYMBOL + 1] = {};  // Сколько блоков каждого типа
+    uint64_t totalIn = 0, totalOut = 0;
+    InputFile mapped;
+    if (mapped.map(inputName)) {
+        unique_ptr<uint8_t[]> output(new uint8_t[maxCompressedSize(mapped.size, blockSize)]);
+        totalIn = mapped.size;
+        totalOut = compressBuffer(mapped.data, mapped.size, output.get(), blockSize, threadCount, maxCodeLength,
+                                  streams, typeCount);
+        if (!writeWholeFile(outputName, output.get(), totalOut)) {
+            cerr << "Ошибка: не удалось записать файл " << outputName << endl;
+            return false;
+        }
+    } else {
+        FILE* input = openStream(inputName, false);
+        if (!input) {
+            cerr << "Ошибка: не удалось открыть файл " << inputName << endl;
+            return false;
+        }
+        FILE* output = fopen(outputName.c_str(), "wb");
+        if (!output) {
+            cerr << "Ошибка: не удалось создать файл " << outputName << endl;
+            closeStream(input);
+            return false;
+        }
+        bool ok = compressStream(input, output, blockSize, threadCount, maxCodeLength, streams, totalIn, totalOut,
+                                 typeCount);
+        closeStream(input);
+        ok = fclose(output) == 0 && ok;
+        if (!ok) {
+            cerr << "Ошибка при сжатии файла " << inputName << endl;
+            return false;
+        }
+    }
+    printCompressSummary(totalIn, totalOut, (totalIn + blockSize - 1) / blockSize, typeCount, threadCount);
+    return true;
+}
+
+// Читает индекс блоков из конца файла; false - индекс отсутствует или испорчен
+bool readBlockIndex(FILE* input, vector<BlockIndexEntry>& index) {
+    uint8_t trailer[CONTAINER_TRAILER_SIZE];
+    if (fseek(input, 0, SEEK_END) != 0) return false;
+    long fileSize = ftell(input);
+    if (fileSize < (long)(CONTAINER_HEADER_SIZE + BLOCK_HEADER_SIZE + CONTAINER_TRAILER_SIZE) ||
+        fseek(input, fileSize - (long)CONTAINER_TRAILER_SIZE, SEEK_SET) != 0 ||
+        fread(trailer, 1, sizeof(trailer), input) != sizeof(trailer) || memcmp(trailer + 16, INDEX_MAGIC, 4) != 0) {
+        return false;
+    }
+    uint64_t count = readU64(trailer);
+    uint64_t indexOffset = readU64(trailer + 8);
+    // Индекс занимает ровно место между концом данных и концевиком
+    uint64_t indexEnd = (uint64_t)fileSize - CONTAINER_TRAILER_SIZE;
+    if (indexOffset > indexEnd || (indexEnd - indexOffset) / BLOCK_INDEX_ENTRY_SIZE != count ||
+        (indexEnd - indexOffset) % BLOCK_INDEX_ENTRY_SIZE != 0 || fseek(input, (long)indexOffset, SEEK_SET) != 0) {
+        return false;
+    }
+
+    vector<uint8_t> bytes(indexEnd - indexOffset);
+    if (fread(bytes.data(), 1, bytes.size(), input) != bytes.size()) return false;
+    index.resize(count);
+    uint64_t expectedOffset = CONTAINER_HEADER_SIZE;  // Блоки идут подряд сразу за заголовком
+    for (uint64_t i = 0; i < count; i++) {
+        const uint8_t* entry = &bytes[i * BLOCK_INDEX_ENTRY_SIZE];
+        index[i] = {readU64(entry), readU32(entry + 8), readU32(entry + 12)};
+        if (index[i].offset != expectedOffset || index[i].frameSize < BLOCK_HEADER_SIZE) return false;
+        expectedOffset += index[i].frameSize;
+    }
+    return expectedOffset + BLOCK_HEADER_SIZE == indexOffset;  // Перед индексом - блок конца данных
+}
+
+// Восстанавливает файл, сжатый compressFile(), в threadCount потоках по индексу блоков
+// Контрольная сумма каждого блока проверяется
+bool decompressFile(const string& inputName, const string& outputName, size_t threadCount) {
+    FILE* input = fopen(inputName.c_str(), "rb");
+    if (!input) {
+        cerr << "Ошибка: не удалось открыть файл " << inputName << endl;
+        return false;
+    }
+    uint8_t header[CONTAINER_HEADER_SIZE];
+    size_t blockSize = 0;
+    vector<BlockIndexEntry> index;
+    if (fread(header, 1, sizeof(header), input) != sizeof(header) || memcmp(header, CONTAINER_MAGIC, 4) != 0 ||
+        header[4] != CONTAINER_VERSION || (blockSize = readU32(header + 5)) == 0 || blockSize > MAX_BLOCK_SIZE ||
+        !readBlockIndex(input, index)) {
+        cerr << "Ошибка: " << inputName << " не является файлом, сжатым этой программой" << endl;
+        fclose(input);
+        return false;
+    }
+    FILE* output = fopen(outputName.c_str(), "wb");
+    if (!output) {
+        cerr << "Ошибка: не удалось создать файл " << outputName << endl;
+        fclose(input);
+        return false;
+    }
+
+    struct Task {
+        uint64_t number;           // Номер блока (для сообщения об ошибке)
+        uint32_t rawSize;
+        uint32_t checksum;
+        uint8_t type;              // BlockType
+        vector<uint8_t> payload;   // Сжатые данные
+        string block;              // Восстановленные данные
+    };
+    size_t nextBlock = 0;
+    bool ok = runBlockPipeline<Task>(
+        threadCount,
+        [&](Task& task, bool& end) {
+            end = nextBlock == index.size();
+            if (end) return true;
+            const BlockIndexEntry& entry = index[nextBlock];
+            uint8_t blockHeader[BLOCK_HEADER_SIZE];
+            uint32_t payloadSize;
+            task.number = nextBlock++;
+            bool read = fseek(input, (long)entry.offset, SEEK_SET) == 0 &&
+                        fread(blockHeader, 1, sizeof(blockHeader), input) == sizeof(blockHeader) &&
+                        readBlockHeader(blockHeader, blockSize, task.rawSize, payloadSize, task.checksum, task.type) &&
+                        task.rawSize == entry.rawSize && payloadSize + BLOCK_HEADER_SIZE == entry.frameSize;
+            if (read) {
+                task.payload.resize(payloadSize);
+                read = fread(task.payload.data(), 1, payloadSize, input) == payloadSize;
+            }
+            if (!read) cerr << "Ошибка: блок " << task.number << " поврежден" << endl;
+            return read;
+        },
+        [](Task& task) {
+            if (!decompressBlock(task.payload, task.type, task.rawSize, task.checksum, task.block)) {
+                cerr << "Ошибка: блок " << task.number << " поврежден" << endl;
+                return false;
+            }
+            return true;
+        },
+        [&](Task& task) {
+            return fwrite(task.block.data(), 1, task.block.size(), output) == task.block.size();
+        });
+
+    fclose(input);
+    ok = fclose(output) == 0 && ok;
+    if (!ok) cerr << "Ошибка при распаковке файла " << inputName << endl;
+    return ok;
+}
+
+// ===== Бенчмарк (--bench): сжатие и распаковка набора данных разного вида =====
+//
+// Набор генерируется по зерну (seeded_random.h), поэтому одинаков при каждом запуске и не хранится в
+// репозитории: текст из слов, двоичные записи, случайные байты и байты с сильно неравномерными частотами.
+
+const char* const BENCHMARK_CORPUS[] = {"text", "binary", "random", "skewed"};
+
+// Генерирует файл набора данных вида kind размером size байт
+string generateCorpusFile(const string& kind, size_t size, uint64_t seed) {
+    string data(size, '\0');
+    if (kind == "text") {
+        // Слова с частотами по закону Ципфа: чем меньше номер, тем чаще (номер ~ 1 / случайное число)
+        static const char* const words[] = {
+            "the", "of", "and", "to", "in", "a", "is", "that", "for", "it", "as", "was", "with", "be",
+            "by", "on", "not", "he", "this", "are", "or", "his", "from", "at", "which", "but", "have",
+            "an", "had", "they", "you", "were", "their", "one", "all", "we", "can", "her", "has", "there",
+            "been", "if", "more", "when", "will", "would", "who", "so", "no", "huffman", "compression"};
+        const size_t wordCount = sizeof(words) / sizeof(words[0]);
+        size_t pos = 0;
+        for (uint64_t i = 0; pos < size; i++) {
+            double unit = seededRandomUnit(seed, i);
+            const char* word = words[min(wordCount - 1, (size_t)(1.0 / (1.0 - unit)) - 1)];
+            uint64_t separator = seededRandomBits(seed ^ 1, i) % 16;
+            for (const char* ch = word; *ch && pos < size; ch++) data[pos++] = *ch;
+            if (pos < size) data[pos++] = separator == 0 ? '\n' : separator == 1 ? ',' : ' ';
+        }
+    } else if (kind == "binary") {
+        // Записи по 16 байт: последовательный номер, тип из 8 значений, малое приращение и случайное значение
+        for (size_t record = 0; record * 16 < size; record++) {
+            uint8_t bytes[16];
+            uint64_t bits = seededRandomBits(seed, record);
+            writeU32((uint32_t)record, bytes);
+            bytes[4] = (uint8_t)(bits & 7);
+            bytes[5] = 0;
+            int16_t delta = (int16_t)((int)((bits >> 3) & 31) - 16);
+            memcpy(bytes + 6, &delta, 2);
+            writeU64(seededRandomBits(seed ^ 2, record), bytes + 8);
+            memcpy(&data[record * 16], bytes, min<size_t>(16, size - record * 16));
+        }
+    } else if (kind == "random") {
+        fillParallel((uint8_t*)&data[0], size, 1, [=](size_t i) { return (uint8_t)seededRandomBits(seed, i); });
+    } else {
+        // Геометрическое распределение: символ 'a' + k с вероятностью 2^-(k+1) - коды длиной до десятков бит
+        fillParallel((uint8_t*)&data[0], size, 1, [=](size_t i) {
+            uint64_t bits = seededRandomBits(seed, i) | (1ull << 40);
+            return (uint8_t)('a' + __builtin_ctzll(bits));
+        });
+    }
+    return data;
+}
+
+#ifdef HUFFMAN_HAS_RUSAGE
+// Наибольший объем памяти процесса из rusage, КиБ
+long peakMemoryKib(const rusage& usage) {
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;  // На macOS - в байтах
+#else
+    return usage.ru_maxrss;
+#endif
+}
+#endif
+
+// Кадр контейнера, разобранный для замера распаковки
+struct BenchmarkFrame {
+    vector<uint8_t> payload;
+    uint8_t type;
+    uint32_t rawSize;
+    uint32_t checksum;
+};
+
+/**
+ * Замеры одного файла набора: сжатие блоками и распаковка в памяти в одном потоке repetitions раз.
+ * Выводит поля объекта JSON от "file" до "blocks" (с запятой после него); false - распаковка не совпала
+ */
+bool benchmarkCorpusFile(const char* kind, size_t size, size_t repetitions, uint64_t seed, size_t blockSize,
+                         int maxCodeLength, int streams) {
+    string original = generateCorpusFile(kind, size, seed);
+    vector<uint8_t> container(maxCompressedSize(original.size(), blockSize));  // Как в compressFile
+    size_t compressed = 0;
+    size_t typeCount[BLOCK_SINGLE_SYMBOL + 1] = {};
+    StageTimes bestStages;
+    DecompressStageTimes bestDecompressStages;
+    double bestCompress = 0, bestDecompress = 0;
+    bool correct = true;
+    vector<BenchmarkFrame> frames;
+    vector<string> blocks;  // Распакованные блоки; между замерами память не освобождается
+
+    for (size_t rep = 0; rep < repetitions; rep++) {
+        StageTimes stages;
+        fill(typeCount, typeCount + BLOCK_SINGLE_SYMBOL + 1, 0);
+        auto start = chrono::steady_clock::now();
+        compressed = compressBuffer((const uint8_t*)original.data(), original.size(), container.data(), blockSize, 1,
+                                    maxCodeLength, streams, typeCount, &stages);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if (rep == 0 || seconds < bestCompress) {
+            bestCompress = seconds;
+            bestStages = stages;
+        }
+
+        // Кадры разбираются до замера, чтобы в него не попало копирование сжатых данных;
+        // кадры идут подряд от заголовка контейнера до блока нулевой длины
+        frames.clear();
+        for (const uint8_t* frame = &container[CONTAINER_HEADER_SIZE]; readU32(frame) != 0;) {
+            const uint8_t* payloadStart = frame + BLOCK_HEADER_SIZE;
+            frames.push_back({vector<uint8_t>(payloadStart, payloadStart + readU32(frame + 4)), frame[12],
+                              readU32(frame), readU32(frame + 8)});
+            frame = payloadStart + frames.back().payload.size();
+        }
+        blocks.resize(frames.size());
+
+        DecompressStageTimes decompressStages;
+        start = chrono::steady_clock::now();
+        for (size_t b = 0; b < frames.size(); b++) {
+            const BenchmarkFrame& frame = frames[b];
+            correct = decompressBlock(frame.payload, frame.type, frame.rawSize, frame.checksum, blocks[b],
+                                      &decompressStages) && correct;
+        }
+        seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if (rep == 0 || seconds < bestDecompress) {
+            bestDecompress = seconds;
+            bestDecompressStages = decompressStages;
+        }
+        size_t offset = 0;
+        for (const string& block : blocks) {
+            correct = correct && original.compare(offset, block.size(), block) == 0;
+            offset += block.size();
+        }
+        correct = correct && offset == original.size();
+    }
+
+    cout << fixed << setprecision(6);
+    cout << "      \"file\": \"" << kind << "\"," << endl;
+    cout << "      \"correct\": " << (correct ? "true" : "false") << "," << endl;
+    cout << "      \"original_bytes\": " << original.size() << "," << endl;
+    cout << "      \"compressed_bytes\": " << compressed << "," << endl;
+    cout << "      \"ratio\": " << (double)compressed / original.size() << "," << endl;
+    cout << "      \"compress_seconds\": " << bestCompress << "," << endl;
+    cout << "      \"decompress_seconds\": " << bestDecompress << "," << endl;
+    cout << setprecision(1);
+    cout << "      \"compress_mb_per_second\": " << original.size() / bestCompress / 1e6 << "," << endl;
+    cout << "      \"decompress_mb_per_second\": " << original.size() / bestDecompress / 1e6 << "," << endl;
+    cout << setprecision(6);
+    cout << "      \"stage_seconds\": {\"histogram\": " << bestStages.histogram << ", \"tree\": " << bestStages.tree
+         << ", \"codegen\": " << bestStages.codegen << ", \"encode\": " << bestStages.encode
+         << ", \"checksum\": " << bestStages.checksum << "}," << endl;
+    cout << "      \"decompress_stage_seconds\": {\"header\": " << bestDecompressStages.header
+         << ", \"table\": " << bestDecompressStages.table << ", \"decode\": " << bestDecompressStages.decode
+         << ", \"checksum\": " << bestDecompressStages.checksum << "}," << endl;
+    cout << "      \"blocks\": {\"huffman\": " << typeCount[BLOCK_HUFFMAN] + typeCount[BLOCK_HUFFMAN_4STREAMS]
+         << ", \"stored\": " << typeCount[BLOCK_STORED] << ", \"single_symbol\": " << typeCount[BLOCK_SINGLE_SYMBOL]
+         << "}," << endl;
+    return correct;
+}
+
+/**
+ * Бенчмарк: каждый файл набора сжимается блоками и распаковывается в памяти в одном потоке
+ * repetitions раз; выводится JSON в stdout. Скорость - по лучшему замеру (МБ = 10^6 байт),
+ * время этапов сжатия (stage_seconds) и распаковки (decompress_stage_seconds) - сумма по блокам
+ * в лучшем замере. Каждая распаковка сверяется с исходными данными.
+ * Каждый файл обрабатывается в отдельном дочернем процессе, поэтому peak_rss_kib - пик памяти
+ * именно этого файла (вместе с его генерацией). Без fork пик общий для всего процесса и выводится
+ * как process_peak_rss_kib.
+ */
+int runBenchmark(size_t size, size_t repetitions, uint64_t seed, size_t blockSize, int maxCodeLength, int streams) {
+    if (size == 0 || repetitions == 0) {
+        cerr << "Ошибка: размер файла и число замеров должны быть положительными." << endl;
+        return 1;
+    }
+    cout << "{" << endl;
+    cout << "  \"benchmark\": \"huffman\"," << endl;
+    cout << "  \"size\": " << size << "," << endl;
+    cout << "  \"repetitions\": " << repetitions << "," << endl;
+    cout << "  \"seed\": " << seed << "," << endl;
+    cout << "  \"block_size\": " << blockSize << "," << endl;
+    cout << "  \"max_code_length\": " << maxCodeLength << "," << endl;
+    cout << "  \"streams\": " << streams << "," << endl;
+    cout << "  \"results\": [" << endl;
+
+    bool allCorrect = true;
+    const size_t corpusSize = sizeof(BENCHMARK_CORPUS) / sizeof(BENCHMARK_CORPUS[0]);
+    for (size_t f = 0; f < corpusSize; f++) {
+        cout << "    {" << endl;
+#ifdef HUFFMAN_HAS_FORK
+        cout.flush();  // Иначе буфер вывода унаследует и повторит дочерний процесс
+        pid_t child = fork();
+        if (child < 0) {
+            cerr << "Ошибка: не удалось запустить процесс для замера." << endl;
+            return 1;
+        }
+        if (child == 0) {
+            bool correct = benchmarkCorpusFile(BENCHMARK_CORPUS[f], size, repetitions, seed, blockSize,
+                                               maxCodeLength, streams);
+            cout.flush();
+            _exit(correct ? 0 : 1);
+        }
+        int status = 0;
+        rusage usage{};
+        bool finished = wait4(child, &status, 0, &usage) == child;
+        // Упавший процесс мог не дописать свои поля - остальной JSON все равно выводится
+        allCorrect = allCorrect && finished && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        cout << "      \"peak_rss_kib\": " << (finished ? peakMemoryKib(usage) : 0) << endl;
+#else
+        allCorrect = benchmarkCorpusFile(BENCHMARK_CORPUS[f], size, repetitions, seed, blockSize, maxCodeLength,
+                                         streams) && allCorrect;
+#ifdef HUFFMAN_HAS_RUSAGE
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        cout << "      \"process_peak_rss_kib\": " << peakMemoryKib(usage) << endl;
+#else
+        cout << "      \"process_peak_rss_kib\": null" << endl;
+#endif
+#endif
+        cout << "    }" << (f + 1 < corpusSize ? "," : "") << endl;
+    }
+
+    cout << "  ]" << endl;
+    cout << "}" << endl;
+    return allCorrect ? 0 : 1;
+}
+
+// Простой генератор для тестовых данных (xorshift64), чтобы самопроверка была воспроизводимой
+uint64_t nextTestRandom(uint64_t& state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+// Самопроверка (--selftest): кодирование и декодирование на разных данных должны давать исходный текст
+int runSelfTest() {
+    vector<pair<string, string>> cases;  // (название, текст)
+    cases.push_back({"пустая строка", ""});
+    cases.push_back({"один символ", "a"});
+    cases.push_back({"один повторяющийся символ", string(100000, 'z')});
+    cases.push_back({"короткий текст", "abracadabra hello"});
+
+    string allBytes;  // Все 256 значений байта - коды длиной около 8 бит
+    for (int repeat = 0; repeat < 4; repeat++) {
+        for (int c = 0; c < 256; c++) allBytes += (char)c;
+    }
+    cases.push_back({"все байты", allBytes});
+
+    uint64_t state = 88172645463325252ull;
+    string randomBytes(1 << 20, '\0');
+    for (char& ch : randomBytes) ch = (char)nextTestRandom(state);
+    cases.push_back({"случайные байты", randomBytes});
+
+    // Частоты - числа Фибоначчи: дерево вырождается, коды длиннее таблицы декодера
+    string skewed;
+    uint64_t a = 1, b = 1;
+    for (int symbol = 0; symbol < 26; symbol++) {
+        skewed.append(a, (char)('A' + symbol));
+        uint64_t next = a + b;
+        a = b;
+        b = next;
+    }
+    for (size_t i = skewed.size() - 1; i > 0; i--) {  // Перемешиваем, чтобы длинные коды шли вперемешку
+        swap(skewed[i], skewed[nextTestRandom(state) % (i + 1)]);
+    }
+    cases.push_back({"длинные коды (частоты Фибоначчи)", skewed});
+
+    string words;
+    const char* dictionary[] = {"the ", "quick ", "brown ", "fox ", "jumps ", "over ", "lazy ", "dog ", "\n"};
+    while (words.size() < (1 << 20)) words += dictionary[nextTestRandom(state) % 9];
+    cases.push_back({"текст из слов", words});
+
+    bool allPassed = true;
+    cout << "=== самопроверка кодирования и декодирования ===" << endl;
+    for (auto& test : cases) {
+        // Каждый текст - с ограничением длины кода по умолчанию и без него (проверяет медленный путь декодера)
+        for (int limit : {DEFAULT_CODE_LENGTH_LIMIT, MAX_CODE_LENGTH}) {
+            CanonicalCode code = buildCodeForText(test.second, limit);
+            vector<uint8_t> encoded = encodeString(test.second, code);
+            string decoded;
+            bool passed = decodeString(encoded, decoded) && decoded == test.second;
+
+            // Package-merge без действующего ограничения должен дать код не хуже дерева Хаффмана
+            Histogram histogram = calculateFrequencies(test.second);
+            uint8_t treeLengths[256] = {}, mergedLengths[256];
+            HuffmanTree tree = buildHuffmanTree(histogram);
+            collectCodeLengths(tree, tree.root, 0, treeLengths);
+            limitCodeLengths(histogram, MAX_CODE_LENGTH, mergedLengths);
+            passed = passed && encodedBitCount(histogram, mergedLengths) == encodedBitCount(histogram, treeLengths);
+
+            // Тот же код в четырех потоках
+            vector<uint8_t> encoded4 = encodeString4(test.second, code);
+            string decoded4;
+            passed = passed && decodeString4(encoded4, decoded4) && decoded4 == test.second;
+
+            // Обрезанные данные должны распознаваться как испорченные, а не читаться за концом
+            if (passed && test.second.size() > 1) {
+                vector<uint8_t> truncated(encoded.begin(), encoded.end() - 1);
+                vector<uint8_t> truncated4(encoded4.begin(), encoded4.end() - 1);
+                string ignored;
+                passed = !decodeString(truncated, ignored) && !decodeString4(truncated4, ignored);
+            }
+            int maxLength = *max_element(code.lengths, code.lengths + 256);
+            passed = passed && maxLength <= limit;
+
+            // Адаптивный код от ограничения не зависит - проверяем один раз
+            if (passed && limit == DEFAULT_CODE_LENGTH_LIMIT) {
+                vector<uint8_t> adaptive = encodeAdaptive(test.second);
+                string adaptiveDecoded, ignored;
+                adaptive.pop_back();
+                passed = !decodeAdaptive(adaptive, ignored);  // Без конца потока данные считаются оборванными
+                adaptive = encodeAdaptive(test.second);
+                passed = passed && decodeAdaptive(adaptive, adaptiveDecoded) && adaptiveDecoded == test.second;
+            }
+            cout << (passed ? "OK     " : "ОШИБКА ") << test.first << ", предел " << limit << " бит (" << test.second.size()
+                 << " байт -> " << encoded.size() << " байт, самый длинный код " << maxLength << " бит)" << endl;
+            allPassed = allPassed && passed;
+        }
+    }
+
+    // Скорость декодирования на 64 МиБ текста
+    string large;
+    large.reserve(64 << 20);
+    while (large.size() < (64 << 20)) large += words;
+    CanonicalCode code = buildCodeForText(large);
+    string decoded;
+    double bestSeconds = 0, singleStreamSpeed = 0;
+    for (int streams : {1, STREAM_COUNT}) {
+        vector<uint8_t> encoded = streams == 1 ? encodeString(large, code) : encodeString4(large, code);
+        bool ok = true;
+        for (int repeat = 0; repeat < 3; repeat++) {  // Лучший из 3 замеров; строка результата переиспользуется
+            auto start = chrono::steady_clock::now();
+            ok = (streams == 1 ? decodeString(encoded, decoded) : decodeString4(encoded, decoded)) && ok;
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            bestSeconds = repeat == 0 ? seconds : min(bestSeconds, seconds);
+        }
+        double speed = large.size() / bestSeconds / (1 << 20);
+        cout << "Декодирование " << (large.size() >> 20) << " МиБ, битовых потоков " << streams << ": " << fixed
+             << setprecision(1) << speed << " МиБ/с";
+        if (streams == 1) {
+            singleStreamSpeed = speed;
+        } else {
+            cout << " (x" << setprecision(2) << speed / singleStreamSpeed << setprecision(1) << ")";
+        }
+        cout << endl;
+        allPassed = allPassed && ok && decoded == large;
+    }
+
+    // Подсчет частот: сверка с простым подсчетом и скорость на тех же 64 МиБ
+    Histogram histogram;
+    for (int repeat = 0; repeat < 3; repeat++) {
+        auto start = chrono::steady_clock::now();
+        histogram = calculateFrequencies(large);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        bestSeconds = repeat == 0 ? seconds : min(bestSeconds, seconds);
+    }
+    uint64_t expected[256] = {};
+    for (unsigned char ch : large) expected[ch]++;
+    bool histogramOk = equal(expected, expected + 256, histogram.counts);
+    cout << (histogramOk ? "OK     " : "ОШИБКА ") << "подсчет частот " << (large.size() >> 20) << " МиБ: "
+         << large.size() / bestSeconds / (1 << 20) << " МиБ/с" << endl;
+    allPassed = allPassed && histogramOk;
+
+    // Адаптивный код против статического: размер, задержка до первого байта результата и скорость.
+    // Статическому кодеру нужны частоты всего текста, прежде чем он выдаст первый бит
+    cout << "Адаптивный код (FGK) против статического:" << endl;
+    vector<pair<string, const string*>> adaptiveCases = {
+        {"текст из слов", &words}, {"частоты Фибоначчи", &skewed}, {"случайные байты", &randomBytes}};
+    for (auto& test : adaptiveCases) {
+        const string& text = *test.second;
+        auto start = chrono::steady_clock::now();
+        CanonicalCode staticCode = buildCodeForHistogram(calculateFrequencies(text), DEFAULT_CODE_LENGTH_LIMIT);
+        double staticLatency = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        size_t staticSize = encodeString(text, staticCode).size();
+        double staticSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        start = chrono::steady_clock::now();
+        size_t adaptiveSize = 4;  // Сигнатура
+        AdaptiveHuffman model;
+        AdaptiveChunk chunk;
+        double adaptiveLatency = 0;
+        for (unsigned char ch : text) {
+            model.encode(ch, chunk.writer);
+            if (adaptiveLatency == 0 && chunk.ready() > 0) {
+                adaptiveLatency = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            }
+            if (chunk.full()) {
+                adaptiveSize += chunk.ready();
+                chunk.clear();
+            }
+        }
+        model.encode(ADAPTIVE_END_OF_STREAM, chunk.writer);
+        chunk.writer.flush();
+        adaptiveSize += chunk.ready();
+        double adaptiveSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        cout << "  " << test.first << ": " << text.size() << " байт -> адаптивный " << adaptiveSize
+             << ", статический " << staticSize << " байт; первый байт через " << setprecision(2)
+             << adaptiveLatency * 1e6 << " / " << staticLatency * 1e6 << " мкс; кодирование " << setprecision(1)
+             << text.size() / adaptiveSeconds / (1 << 20) << " / " << text.size() / staticSeconds / (1 << 20)
+             << " МиБ/с" << endl;
+    }
+
+    // Файл через контейнер: несколько блоков разного содержания, затем порча одного байта
+    string fileData = words + randomBytes + skewed + string(300000, 'q');
+    const string original = "huffman_selftest.tmp", packed = "huffman_selftest.huf", unpacked = "huffman_selftest.out";
+    FILE* file = fopen(original.c_str(), "wb");
+    bool fileOk = file && fwrite(fileData.data(), 1, fileData.size(), file) == fileData.size();
+    if (file) fileOk = fclose(file) == 0 && fileOk;
+    fileOk = fileOk && compressFile(original, packed, DEFAULT_BLOCK_SIZE, 1) && decompressFile(packed, unpacked, 4);
+    string restored;
+    file = fopen(unpacked.c_str(), "rb");
+    if (file) {
+        restored.resize(fileData.size() + 1);
+        restored.resize(fread(&restored[0], 1, restored.size(), file));
+        fclose(file);
+    }
+    fileOk = fileOk && restored == fileData;
+
+    // Сжатие в 4 потока должно дать тот же файл, что и в один поток
+    string single, parallel;
+    auto readAll = [](const string& name, string& data) {
+        FILE* in = fopen(name.c_str(), "rb");
+        if (!in) return false;
+        char chunk[1 << 16];
+        size_t got;
+        while ((got = fread(chunk, 1, sizeof(chunk), in)) > 0) data.append(chunk, got);
+        fclose(in);
+        return true;
+    };
+    fileOk = fileOk && readAll(packed, single) && compressFile(original, packed, DEFAULT_BLOCK_SIZE, 4) &&
+             readAll(packed, parallel) && single == parallel;
+
+    // Потоковое сжатие (вход не отображается в память - канал, stdin) должно дать тот же файл
+    string streamed;
+    FILE* streamIn = fopen(original.c_str(), "rb");
+    FILE* streamOut = fopen(packed.c_str(), "wb");
+    uint64_t streamedIn = 0, streamedOut = 0;
+    size_t streamedTypes[BLOCK_SINGLE_SYMBOL + 1] = {};
+    bool streamOk = streamIn && streamOut &&
+                    compressStream(streamIn, streamOut, DEFAULT_BLOCK_SIZE, 3, DEFAULT_CODE_LENGTH_LIMIT, STREAM_COUNT,
+                                   streamedIn, streamedOut, streamedTypes);
+    if (streamIn) fclose(streamIn);
+    if (streamOut) streamOk = fclose(streamOut) == 0 && streamOk;
+    fileOk = fileOk && streamOk && readAll(packed, streamed) && streamed == single && streamedOut == single.size();
+    file = fopen(packed.c_str(), "r+b");
+    if (file) {  // Портим байт в середине: распаковка должна сообщить об ошибке
+        fseek(file, 200000, SEEK_SET);
+        int byte = fgetc(file);
+        fseek(file, 200000, SEEK_SET);
+        fputc(byte ^ 0x20, file);
+        fclose(file);
+    }
+    cout << "Проверка поврежденного файла (ожидается сообщение об ошибке):" << endl;
+    fileOk = fileOk && !decompressFile(packed, unpacked, 2);
+    remove(original.c_str());
+    remove(packed.c_str());
+    remove(unpacked.c_str());
+    cout << (fileOk ? "OK     " : "ОШИБКА ") << "файл через контейнер (" << fileData.size() << " байт)" << endl;
+    allPassed = allPassed && fileOk;
+
+    // Выбор способа хранения: случайные данные не сжимаются, один символ - один байт, текст - код Хаффмана
+    vector<pair<string, BlockType>> blocks = {{randomBytes.substr(0, DEFAULT_BLOCK_SIZE), BLOCK_STORED},
+                                              {string(DEFAULT_BLOCK_SIZE, 'q'), BLOCK_SINGLE_SYMBOL},
+                                              {words.substr(0, DEFAULT_BLOCK_SIZE), BLOCK_HUFFMAN_4STREAMS},
+                                              {allBytes, BLOCK_STORED}};
+    bool blocksOk = true;
+    for (auto& test : blocks) {
+        vector<uint8_t> frame = compressBlock(test.first, DEFAULT_CODE_LENGTH_LIMIT, STREAM_COUNT);
+        vector<uint8_t> payload(frame.begin() + BLOCK_HEADER_SIZE, frame.end());
+        string restoredBlock;
+        blocksOk = blocksOk && frame[12] == test.second && frame.size() <= test.first.size() + BLOCK_HEADER_SIZE &&
+                   decompressBlock(payload, frame[12], test.first.size(), readU32(&frame[8]), restoredBlock) &&
+                   restoredBlock == test.first;
+    }
+    cout << (blocksOk ? "OK     " : "ОШИБКА ") << "выбор способа хранения блока" << endl;
+    allPassed = allPassed && blocksOk;
+
+    // Испорченный заголовок кодов в блоке из четырех потоков: самый длинный код удлинен на бит, код становится
+    // неполным (проходит проверку Крафта), и в таблице декодера появляются незанятые записи.
+    // Распаковка должна отказать, а не зациклиться
+    string corruptText = words.substr(0, DEFAULT_BLOCK_SIZE);
+    vector<uint8_t> corruptFrame = compressBlock(corruptText, DEFAULT_CODE_LENGTH_LIMIT, STREAM_COUNT);
+    vector<uint8_t> corruptPayload(corruptFrame.begin() + BLOCK_HEADER_SIZE, corruptFrame.end());
+    const uint8_t* headerPos = corruptPayload.data();
+    uint64_t corruptLength;
+    readVarint(headerPos, headerPos + corruptPayload.size(), corruptLength);
+    size_t pairs = headerPos - corruptPayload.data() + 1;  // Пары (байт, длина кода) за числом символов
+    size_t longest = pairs + 1;
+    for (size_t i = pairs + 1; i < pairs + 2 * (corruptPayload[pairs - 1] + 1); i += 2) {
+        if (corruptPayload[i] > corruptPayload[longest]) longest = i;
+    }
+    corruptPayload[longest]++;
+    string corruptRestored;
+    bool corruptOk = corruptFrame[12] == BLOCK_HUFFMAN_4STREAMS &&
+                     !decompressBlock(corruptPayload, BLOCK_HUFFMAN_4STREAMS, corruptText.size(),
+                                      readU32(&corruptFrame[8]), corruptRestored);
+    cout << (corruptOk ? "OK     " : "ОШИБКА ") << "неполный код в блоке из четырех потоков" << endl;
+    allPassed = allPassed && corruptOk;
+
+    cout << (allPassed ? "Все проверки пройдены" : "Есть ошибки") << endl;
+    return allPassed ? 0 : 1;
+}
+
+const size_t MAX_BENCH_REPETITIONS = 1000;  // Больше замеров ничего не уточняет, а бенчмарк идет часами
+
+// Параметры командной строки
+struct Options {
+    string mode = "--demo";      // --demo, --selftest, --bench, -c/-d (сжатие/распаковка блоками), -ac/-ad (адаптивные)
+    string inputFile;            // Входной файл для -c/-d/-ac/-ad
+    string outputFile;           // Выходной файл для -c/-d/-ac/-ad
+    size_t blockSize = DEFAULT_BLOCK_SIZE;  // Размер блока при сжатии
+    size_t threads = 1;          // Число рабочих потоков для -c/-d
+    int maxCodeLength = DEFAULT_CODE_LENGTH_LIMIT;  // Ограничение длины кода при сжатии
+    int streams = STREAM_COUNT;  // Число битовых потоков в блоке: 1 или 4
+    size_t benchSize = 8 << 20;  // Размер каждого файла набора в режиме --bench
+    size_t repetitions = 3;      // Число замеров в режиме --bench
+    uint64_t seed = 42;          // Зерно генерации набора для --bench
+};
+
+// Выводит справку по аргументам командной строки
+void printUsage(const char* program) {
+    cerr << "Использование: " << program << " [--demo]" << endl;
+    cerr << "       " << program << " -c ВХОД ВЫХОД [--block КИБ] [--threads N] [--max-code-length БИТ] [--streams 1|4]" << endl;
+    cerr << "       " << program << " -d ВХОД ВЫХОД [--threads N]" << endl;
+    cerr << "       " << program << " -ac ВХОД ВЫХОД | -ad ВХОД ВЫХОД" << endl;
+    cerr << "       " << program << " --selftest" << endl;
+    cerr << "       " << program << " --bench [--size БАЙТ] [--repeat R] [--seed S] [--block КИБ] [--streams 1|4]"
+         << " [--max-code-length БИТ]" << endl;
+    cerr << "  --demo             интерактивная демонстрация на одной строке (по умолчанию)" << endl;
+    cerr << "  -c ВХОД ВЫХОД      сжать файл независимыми блоками (\"-\" - stdin, читается потоком)" << endl;
+    cerr << "  -d ВХОД ВЫХОД      распаковать файл, проверив контрольные суммы блоков" << endl;
+    cerr << "  -ac ВХОД ВЫХОД     адаптивное сжатие за один проход (вывод идет сразу, \"-\" - stdin/stdout)" << endl;
+    cerr << "  -ad ВХОД ВЫХОД     распаковка адаптивного сжатия по мере поступления данных" << endl;
+    cerr << "  --block КИБ        размер блока при сжатии (по умолчанию 128)" << endl;
+    cerr << "  --max-code-length БИТ  наибольшая длина кода (1.." << MAX_CODE_LENGTH << ", по умолчанию "
+         << DEFAULT_CODE_LENGTH_LIMIT << ")" << endl;
+    cerr << "  --streams 1|4      число битовых потоков в блоке (по умолчанию 4 - быстрее распаковка)" << endl;
+    cerr << "  --threads N        число потоков сжатия и распаковки (по умолчанию 1; результат от него не зависит)" << endl;
+    cerr << "  --selftest         проверить кодирование и декодирование" << endl;
+    cerr << "  --bench            замерить сжатие и распаковку набора данных (text, binary, random, skewed), JSON в stdout" << endl;
+    cerr << "  --size БАЙТ        размер каждого файла набора (по умолчанию 8 МиБ)" << endl;
+    cerr << "  --repeat R         число замеров (1.." << MAX_BENCH_REPETITIONS << ", по умолчанию 3)" << endl;
+    cerr << "  --seed S           зерно генерации набора (по умолчанию 42)" << endl;
+}
+
+// Разбирает аргументы командной строки; false - аргументы некорректны
+bool parseArguments(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--demo" || arg == "--selftest" || arg == "--bench") {
+            options.mode = arg;
+        } else if (arg == "-c" || arg == "-d" || arg == "-ac" || arg == "-ad") {
+            if (i + 2 >= argc) {
+                cerr << "Ошибка: после " << arg << " ожидаются входной и выходной файлы." << endl;
+                return false;
+            }
+            options.mode = arg;
+            options.inputFile = argv[++i];
+            options.outputFile = argv[++i];
+        } else if (arg == "--block") {
+            char* end = nullptr;
+            unsigned long long kibibytes = i + 1 < argc ? strtoull(argv[i + 1], &end, 10) : 0;
+            if (kibibytes == 0 || *end != '\0' || kibibytes * 1024 > MAX_BLOCK_SIZE) {
+                cerr << "Ошибка: после --block ожидается размер блока в КиБ (1.." << MAX_BLOCK_SIZE / 1024 << ")." << endl;
+                return false;
+            }
+            options.blockSize = kibibytes * 1024;
+            i++;
+        } else if (arg == "--threads") {
+            char* end = nullptr;
+            unsigned long long threads = i + 1 < argc ? strtoull(argv[i + 1], &end, 10) : 0;
+            if (threads == 0 || *end != '\0' || threads > 1024) {
+                cerr << "Ошибка: после --threads ожидается число потоков (1..1024)." << endl;
+                return false;
+            }
+            options.threads = threads;
+            i++;
+        } else if (arg == "--max-code-length") {
+            char* end = nullptr;
+            unsigned long long length = i + 1 < argc ? strtoull(argv[i + 1], &end, 10) : 0;
+            if (length == 0 || *end != '\0' || length > MAX_CODE_LENGTH) {
+                cerr << "Ошибка: после --max-code-length ожидается длина кода в битах (1.." << MAX_CODE_LENGTH << ")." << endl;
+                return false;
+            }
+            options.maxCodeLength = length;
+            i++;
+        } else if (arg == "--size" || arg == "--repeat" || arg == "--seed") {
+            const char* text = i + 1 < argc ? argv[i + 1] : "";
+            char* end = nullptr;
+            errno = 0;
+            unsigned long long value = strtoull(text, &end, 10);
+            unsigned long long limit = arg == "--size"     ? MAX_BLOCK_SIZE * 16
+                                       : arg == "--repeat" ? MAX_BENCH_REPETITIONS
+                                                           : ULLONG_MAX;
+            // strtoull сам принимает знак минус и пробелы - число должно начинаться с цифры
+            if (*text < '0' || *text > '9' || *end != '\0' || errno == ERANGE || value > limit) {
+                cerr << "Ошибка: после " << arg << " ожидается неотрицательное число"
+                     << (arg == "--size" ? " (не больше 1 ГиБ)." : arg == "--repeat" ? " (не больше 1000)." : ".")
+                     << endl;
+                return false;
+            }
+            if (arg == "--size") options.benchSize = value;
+            if (arg == "--repeat") options.repetitions = value;
+            if (arg == "--seed") options.seed = value;
+            i++;
+        } else if (arg == "--streams") {
+            string value = i + 1 < argc ? argv[i + 1] : "";
+            if (value != "1" && value != "4") {
+                cerr << "Ошибка: после --streams ожидается 1 или 4." << endl;
+                return false;
+            }
+            options.streams = value == "1" ? 1 : STREAM_COUNT;
+            i++;
+        } else {
+            cerr << "Неизвестный аргумент: " << arg << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Интерактивная демонстрация: одна строка, таблица частот, коды, дерево и пошаговое кодирование
+int runDemo(int maxCodeLength) {
+
     cout << "=== алгоритм хаффмана ===" << endl;
     cout << "Введите строку для кодирования: ";
     
@@ -182,32 +2474,39 @@ int main() {
     }
     
     // Подсчитываем частоты всех символов
-    map<char, int> frequencies = calculateFrequencies(input); // ассоциативный массив (типо словарь) с кол-вом всех символов
+    Histogram frequencies = calculateFrequencies(input); // частоты всех 256 значений байта
     
     cout << "\n=== частоты символов ===" << endl;
-    // Выводим таблицу частот для анализа
-    for (auto& pair : frequencies) { //// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-        char ch = pair.first; // pair - тип данных который состоит из первого и второго элемента
+    // Выводим таблицу частот для анализа (только встречающиеся символы)
+    for (int c = 0; c < 256; c++) {
+        if (frequencies.counts[c] == 0) continue;
+        char ch = c;
         // Специальная обработка непечатаемых символов
         if (ch == ' ') {
-            cout << "'SPACE': " << pair.second << endl;
+            cout << "'SPACE': " << frequencies.counts[c] << endl;
         } else if (ch == '\n') {
-            cout << "'NEWLINE': " << pair.second << endl;
+            cout << "'NEWLINE': " << frequencies.counts[c] << endl;
         } else if (ch == '\t') {
-            cout << "'TAB': " << pair.second << endl;
+            cout << "'TAB': " << frequencies.counts[c] << endl;
         } else {
-            cout << "'" << ch << "': " << pair.second << endl;
+            cout << "'" << ch << "': " << frequencies.counts[c] << endl;
         }
     }
     
     // Строим дерево Хаффмана на основе частот
-    Node* root = buildHuffmanTree(frequencies);
+    HuffmanTree tree = buildHuffmanTree(frequencies);
     
-    // Генерируем коды для каждого символа
-    map<char, string> codes;
-    generateCodes(root, "", codes);  // Начинаем с пустого кода
+    // Длины кодов берем из дерева (если оно слишком глубокое - из package-merge),
+    // сами коды назначаем канонически
+    uint8_t lengths[256];
+    buildCodeLengths(frequencies, maxCodeLength, lengths);
+    CanonicalCode code = buildCanonicalCode(lengths);
+    map<char, string> codes;  // Коды в виде строк - только для вывода
+    for (int c = 0; c < 256; c++) {
+        if (code.lengths[c] > 0) codes[(char)c] = codeToString(code.codes[c], code.lengths[c]);
+    }
     
-    cout << "\n=== коды хаффмана ===" << endl;
+    cout << "\n=== канонические коды хаффмана ===" << endl;
     // Выводим полученные коды для проверки
     for (auto& pair : codes) {
         char ch = pair.first;
@@ -225,16 +2524,27 @@ int main() {
     
     // Визуализируем построенное дерево
     cout << "\n=== дерево хаффмана ===" << endl;
-    printTree(root);  // Выводим структуру дерева
+    printTree(tree, tree.root);  // Выводим структуру дерева
     
     // Кодируем исходную строку
-    string encoded = encodeString(input, codes);
+    vector<uint8_t> encoded = encodeString(input, code);
+    size_t headerBytes = codeHeaderSize(input.size(), code);
     cout << "\n=== результат кодирования ===" << endl;
     cout << "Исходная строка: \"" << input << "\"" << endl;
-    cout << "Закодированная строка: " << encoded << endl;
+    cout << "Закодированные данные (" << encoded.size() << " байт): " << hex << setfill('0');
+    for (uint8_t byte : encoded) {
+        cout << setw(2) << (int)byte << " ";
+    }
+    cout << dec << setfill(' ') << endl;
     
     // Анализируем эффективность сжатия
-    printCompressionStats(input, encoded);
+    printCompressionStats(input, encoded, headerBytes, code);
+
+    // Декодируем обратно и сверяем с исходной строкой
+    string decoded;
+    bool decodedOk = decodeString(encoded, decoded);
+    cout << "Декодированная строка: \"" << decoded << "\" ("
+         << (decodedOk && decoded == input ? "совпадает с исходной" : "ОШИБКА: не совпадает с исходной") << ")" << endl;
     
     // Демонстрируем пошаговое кодирование
     cout << "\n=== проверка кодирования ===" << endl;
@@ -255,4 +2565,29 @@ int main() {
         cout << "'" << charName << "' → " << codes[ch] << endl;
     }
     return 0;  // Успешное завершение программы
-}
\ No newline at end of file
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseArguments(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    if (options.mode == "--selftest") {
+        return runSelfTest();  // Проверка кодера и декодера
+    } else if (options.mode == "--bench") {
+        return runBenchmark(options.benchSize, options.repetitions, options.seed, options.blockSize,
+                            options.maxCodeLength, options.streams);
+    } else if (options.mode == "-c") {
+        return compressFile(options.inputFile, options.outputFile, options.blockSize, options.threads,
+                            options.maxCodeLength, options.streams) ? 0 : 1;
+    } else if (options.mode == "-ac") {
+        return compressAdaptive(options.inputFile, options.outputFile) ? 0 : 1;
+    } else if (options.mode == "-ad") {
+        return decompressAdaptive(options.inputFile, options.outputFile) ? 0 : 1;
+    } else if (options.mode == "-d") {
+        return decompressFile(options.inputFile, options.outputFile, options.threads) ? 0 : 1;
+    }
+    return runDemo(options.maxCodeLength);  // Без аргументов - прежний интерактивный режим
+}
@@ -0,0 +1,126 @@
+// Воспроизводимая генерация случайных чисел по зерну, общая для sorting.cpp, binary_tree.cpp и b_plus_plus.cpp
+//
+// Генератор счетный (counter-based): i-е число потока зависит только от зерна и i,
+// а не от того, сколько чисел было сгенерировано до него. Поэтому массив можно
+// заполнять кусками в нескольких потоках, и результат не зависит от числа потоков.
+#pragma once
+
+#include <cstdint>   // Для uint64_t
+#include <cerrno>    // Для errno (переполнение в strtoull)
+#include <cstdlib>   // Для strtoull
+#include <cstring>   // Для strcmp
+#include <algorithm> // Для min, max
+#include <iostream>  // Для сообщения о неверном --seed
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Шаг счетчика SplitMix64 (дробная часть золотого сечения, умноженная на 2^64)
+const uint64_t SEEDED_RANDOM_GAMMA = 0x9E3779B97F4A7C15ull;
+
+// Меньше этого числа элементов на поток генерация не делится - запуск потока дороже
+const size_t SEEDED_RANDOM_GRAIN = 1 << 16;
+
+// Перемешивающая функция SplitMix64: биективно превращает 64-битный счетчик в случайное на вид число
+inline uint64_t splitMix64(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+// Случайное 64-битное число с номером index в потоке, заданном зерном seed
+inline uint64_t seededRandomBits(uint64_t seed, uint64_t index) {
+    // Зерно тоже перемешивается, чтобы близкие зерна давали несвязанные потоки
+    return splitMix64(splitMix64(seed) + (index + 1) * SEEDED_RANDOM_GAMMA);
+}
+
+// Отображает 64 случайных бита в [0, range) умножением (без деления и без отбрасывания значений)
+inline uint64_t scaleToRange(uint64_t bits, uint64_t range) {
+#ifdef __SIZEOF_INT128__
+    return static_cast<uint64_t>((static_cast<unsigned __int128>(bits) * range) >> 64);
+#else
+    return bits % range;
+#endif
+}
+
+/**
+ * @brief Случайное целое из [minValue, maxValue] с номером index в потоке seed
+ */
+template <typename T>
+T seededRandomValue(uint64_t seed, uint64_t index, T minValue, T maxValue) {
+    static_assert(std::is_integral<T>::value, "seededRandomValue генерирует только целые числа");
+    using Unsigned = typename std::make_unsigned<T>::type;
+    uint64_t bits = seededRandomBits(seed, index);
+    // Ширина диапазона как беззнаковое число; 0 означает весь 64-битный диапазон
+    uint64_t range = static_cast<uint64_t>(static_cast<Unsigned>(maxValue) - static_cast<Unsigned>(minValue)) + 1;
+    uint64_t offset = range == 0 ? bits : scaleToRange(bits, range);
+    return static_cast<T>(static_cast<Unsigned>(static_cast<Unsigned>(minValue) + offset));
+}
+
+// Случайное вещественное из [0, 1) с номером index в потоке seed (53 значащих бита)
+inline double seededRandomUnit(uint64_t seed, uint64_t index) {
+    return (seededRandomBits(seed, index) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * @brief Заполняет out[0, n) значениями generate(i) в threadCount потоках
+ *
+ * Каждый поток пишет свой непрерывный кусок заранее выделенного массива,
+ * поэтому синхронизация не нужна.
+ */
+template <typename T, typename Generate>
+void fillParallel(T* out, size_t n, size_t threadCount, Generate generate) {
+    size_t threads = std::max<size_t>(1, std::min(threadCount, n / SEEDED_RANDOM_GRAIN));
+    auto fillRange = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            out[i] = generate(i);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < threads; t++) {
+        workers.emplace_back(fillRange, n * t / threads, n * (t + 1) / threads);
+    }
+    fillRange(0, n / threads);  // Первый кусок заполняет вызывающий поток
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+/**
+ * @brief Заполняет out[0, n) случайными целыми из [minValue, maxValue]
+ *
+ * out[i] = seededRandomValue(seed, i, minValue, maxValue), поэтому результат
+ * одинаков при любом threadCount.
+ */
+template <typename T>
+void fillSeededRandom(T* out, size_t n, T minValue, T maxValue, uint64_t seed, size_t threadCount) {
+    fillParallel(out, n, threadCount, [=](size_t i) { return seededRandomValue(seed, i, minValue, maxValue); });
+}
+
+/**
+ * @brief Ищет среди аргументов командной строки "--seed N"
+ *
+ * @param seedGiven true, если зерно задано (оно записано в seed)
+ * @return false если после --seed нет неотрицательного числа (сообщение уже выведено в stderr);
+ *         вызывающий должен завершиться с ошибкой, а не молча брать случайное зерно
+ */
+inline bool findSeedArgument(int argc, char* argv[], uint64_t& seed, bool& seedGiven) {
+    seedGiven = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--seed") == 0) {
+            const char* value = i + 1 < argc ? argv[i + 1] : "";
+            char* end = nullptr;
+            errno = 0;
+            seed = std::strtoull(value, &end, 10);
+            // strtoull принимает знак минус и пробелы в начале, а при переполнении дает максимум - это тоже ошибки
+            if (*value < '0' || *value > '9' || *end != '\0' || errno == ERANGE) {
+                std::cerr << "Ошибка: после --seed ожидается неотрицательное число." << std::endl;
+                return false;
+            }
+            seedGiven = true;
+            return true;
+        }
+    }
+    return true;
+}
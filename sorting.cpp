@@ -4,8 +4,38 @@
 #include <random>
 #include <string>
 #include <ctime>
+#include <iomanip> // Для setprecision
 #include <limits>  // Для numeric_limits
 #include <cctype>  // Для isdigit
+#include <algorithm> // Для min, copy
+#include <atomic>    // Для счетчиков задач пула потоков
+#include <charconv>  // Для to_chars при форматировании чисел
+#include <chrono>    // Для замеров времени в режиме бенчмарка
+#include <condition_variable>
+#include <cstdint>   // Для uint32_t
+#include <cstdio>    // Для буферизованного файлового ввода-вывода (fread/fwrite)
+#include <cstring>   // Для memcpy
+#include <deque>     // Для очередей задач пула потоков
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>  // Для векторных инструкций SSE4.1 / AVX2
+#define SORTING_HAS_X86_SIMD 1
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>      // Для open
+#include <sys/mman.h>   // Для mmap - отображения файлов в память
+#include <sys/stat.h>   // Для fstat
+#include <unistd.h>     // Для close, sysconf
+#define SORTING_HAS_MMAP 1
+#define SORTING_HAS_SYSCONF 1
+#endif
+
+#include "seeded_random.h"  // Для воспроизводимой параллельной генерации по зерну
 
 using namespace std;
 
@@ -27,198 +57,2666 @@ bool getNumericInput(int& value, const string& prompt) { // проверка н
         cout << "Ошибка: Введите числовое значение." << endl;
         return false;
     }
-    
-    // Очищаем остаток буфера
-    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+    
+    // Очищаем остаток буфера
+    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+    return true;
+}
+
+// Тип элементов, на которые указывает итератор
+template <typename RandomIt>
+using ValueOf = typename iterator_traits<RandomIt>::value_type;
+
+// Сравнение по умолчанию - по возрастанию, как оператор <
+template <typename RandomIt>
+using DefaultLess = less<ValueOf<RandomIt>>;
+
+// Итератор указывает на непрерывный массив (указатель или итератор vector, кроме vector<bool>)
+template <typename RandomIt>
+constexpr bool IS_CONTIGUOUS_ITERATOR =
+    is_pointer<RandomIt>::value ||
+    (!is_same<ValueOf<RandomIt>, bool>::value &&
+     is_same<RandomIt, typename vector<ValueOf<RandomIt>>::iterator>::value);
+
+// Для сортировки int по возрастанию есть векторные примитивы (см. SortKernels)
+template <typename T, typename Compare>
+constexpr bool USES_INT_KERNELS =
+    is_same<T, int>::value && (is_same<Compare, less<int>>::value || is_same<Compare, less<>>::value);
+
+/**
+ * @brief Копирует элементы [first, last) в out
+ * 
+ * Диапазоны не должны перекрываться (или должны совпадать - тогда копирование пропускается).
+ * Тривиально копируемые типы (целые, double, записи фиксированной длины без конструкторов)
+ * копируются одним memcpy, остальные - поэлементно.
+ */
+template <typename T>
+inline void copyElements(const T* first, const T* last, T* out) {
+    if (first == out || first == last) {
+        return;
+    }
+    if constexpr (is_trivially_copyable<T>::value) {
+        memcpy(static_cast<void*>(out), static_cast<const void*>(first), (last - first) * sizeof(T));
+    } else {
+        copy(first, last, out);
+    }
+}
+
+/**
+ * @brief Вызывает sortPointer(data, n) для диапазона [first, last) как для непрерывного массива
+ * 
+ * Непрерывные диапазоны сортируются на месте. Прочие (например, deque) переносятся
+ * во временный vector и обратно - так все движки работают с обычными указателями
+ * и индексами size_t, без ограничения в 2^31 элементов.
+ */
+template <typename RandomIt, typename SortPointer>
+void sortContiguous(RandomIt first, RandomIt last, SortPointer sortPointer) {
+    using T = ValueOf<RandomIt>;
+    size_t n = static_cast<size_t>(last - first);
+    if (n < 2) {
+        return;
+    }
+    if constexpr (IS_CONTIGUOUS_ITERATOR<RandomIt>) {
+        sortPointer(&*first, n);
+    } else {
+        vector<T> temp(make_move_iterator(first), make_move_iterator(last));
+        sortPointer(temp.data(), n);
+        move(temp.begin(), temp.end(), first);
+    }
+}
+
+/**
+ * @brief Счетчик операций сортировки для режима бенчмарка
+ * 
+ * comparisons - сравнения ключей, moves - присваивания элементов
+ * (включая запись во временную переменную и во вспомогательный буфер).
+ */
+struct OperationCounter {
+    uint64_t comparisons = 0;
+    uint64_t moves = 0;
+
+    void compare(uint64_t count = 1) {
+        comparisons += count;
+    }
+
+    void move(uint64_t count = 1) {
+        moves += count;
+    }
+};
+
+// Пустой счетчик: его вызовы компилятор убирает полностью, обычная сортировка ничего не теряет
+struct NoCounter {
+    void compare(uint64_t = 1) {}
+    void move(uint64_t = 1) {}
+};
+
+/**
+ * @brief Объединяет два отсортированных подмассива в один отсортированный массив
+ * 
+ * Это часть алгоритма прямой сортировки слиянием. Функция принимает два соседних отсортированных
+ * подмассива и объединяет их в один отсортированный массив.
+ * Левый подмассив копируется во вспомогательный буфер, правый читается на месте:
+ * позиция записи никогда не обгоняет позицию чтения правого подмассива.
+ * 
+ * @param arr Массив, содержащий оба подмассива для слияния
+ * @param buffer Вспомогательный буфер (выделяется один раз на всю сортировку)
+ * @param left Начальный индекс первого подмассива
+ * @param mid Начальный индекс второго подмассива (конец первого)
+ * @param right Конец второго подмассива (не включительно)
+ * @param comp Сравнение элементов ("меньше")
+ */
+template <typename T, typename Compare>
+void mergeHalves(T* arr, T* buffer, size_t left, size_t mid, size_t right, Compare comp) {
+    // Копируем первый подмассив во временный буфер
+    size_t n1 = mid - left;
+    copyElements(arr + left, arr + mid, buffer);
+
+    size_t i = 0;     // Начальный индекс первого подмассива (в буфере)
+    size_t j = mid;   // Начальный индекс второго подмассива
+    size_t k = left;  // Начальный индекс объединенного подмассива
+
+    // Сравниваем элементы из обоих подмассивов и помещаем меньший в исходный массив;
+    // при равенстве берем элемент первого подмассива - слияние устойчиво
+    while (i < n1 && j < right) {
+        if (comp(arr[j], buffer[i])) {
+            arr[k++] = arr[j++];
+        } else {
+            arr[k++] = buffer[i++];
+        }
+    }
+
+    // Копируем оставшиеся элементы первого подмассива; остаток второго уже на месте
+    copyElements(buffer + i, buffer + n1, arr + k);
+}
+
+template <typename T, typename Compare>
+void mergeSortRecursive(T* arr, T* buffer, size_t left, size_t right, Compare comp) {
+    if (right - left > 1) {
+        // Находим среднюю точку для разделения массива на две половины
+        size_t mid = left + (right - left) / 2;
+
+        // Сортируем первую и вторую половины
+        mergeSortRecursive(arr, buffer, left, mid, comp);
+        mergeSortRecursive(arr, buffer, mid, right, comp);
+
+        // Объединяем отсортированные половины
+        mergeHalves(arr, buffer, left, mid, right, comp);
+    }
+}
+
+/**
+ * @brief Реализует алгоритм прямой сортировки слиянием рекурсивно
+ * 
+ * Это классическая реализация сортировки слиянием (прямое слияние), которая следует
+ * подходу "разделяй и властвуй":
+ * 1. Делит массив на две равные половины
+ * 2. Рекурсивно сортирует две половины
+ * 3. Объединяет отсортированные половины
+ * 
+ * В отличие от естественной сортировки слиянием, которая находит и объединяет уже отсортированные
+ * последовательности, прямая сортировка слиянием искусственно делит массив независимо от существующего порядка.
+ * 
+ * @param first Начало сортируемого диапазона
+ * @param last Конец сортируемого диапазона
+ * @param comp Сравнение элементов ("меньше"), по умолчанию оператор <
+ */
+template <typename RandomIt, typename Compare = DefaultLess<RandomIt>>
+void mergeSort(RandomIt first, RandomIt last, Compare comp = Compare()) {
+    using T = ValueOf<RandomIt>;
+    sortContiguous(first, last, [&](T* data, size_t n) {
+        vector<T> buffer((n + 1) / 2);  // Левая половина любого слияния не длиннее (n + 1) / 2
+        mergeSortRecursive(data, buffer.data(), 0, n, comp);
+    });
+}
+
+// Участки не длиннее этого значения сортируются вставками до начала слияний
+const size_t INSERTION_SORT_CUTOFF = 32;
+
+/**
+ * @brief Сортирует небольшой участок массива вставками
+ * 
+ * На коротких участках сортировка вставками быстрее слияния: нет накладных расходов
+ * на вспомогательный буфер, а данные целиком лежат в кэше.
+ * 
+ * @param arr Указатель на начало участка
+ * @param n Длина участка
+ * @param comp Сравнение элементов ("меньше")
+ * @param counter Счетчик операций
+ */
+template <typename T, typename Compare, typename Counter>
+void insertionSort(T* arr, size_t n, Compare comp, Counter& counter) {
+    for (size_t i = 1; i < n; i++) {
+        T value = arr[i];
+        size_t j = i;
+        counter.move();
+        // Сдвигаем большие элементы вправо, пока не найдем место для value
+        while (j > 0) {
+            counter.compare();
+            if (!comp(value, arr[j - 1])) {
+                break;
+            }
+            arr[j] = arr[j - 1];
+            counter.move();
+            j--;
+        }
+        arr[j] = value;
+        counter.move();
+    }
+}
+
+void insertionSort(int* arr, size_t n) {
+    NoCounter none;
+    insertionSort(arr, n, less<int>(), none);
+}
+
+/**
+ * @brief Сливает два отсортированных массива a и b в out
+ * 
+ * Не выделяет память: результат пишется в заранее выделенный буфер.
+ * При равенстве берется элемент из a, поэтому слияние устойчиво, как и в mergeHalves().
+ * 
+ * @param a Первый отсортированный массив
+ * @param n1 Длина первого массива
+ * @param b Второй отсортированный массив
+ * @param n2 Длина второго массива
+ * @param out Буфер для результата длиной n1 + n2
+ * @param comp Сравнение элементов ("меньше")
+ * @param counter Счетчик операций
+ */
+template <typename T, typename Compare, typename Counter>
+void mergeArrays(const T* a, size_t n1, const T* b, size_t n2, T* out, Compare comp, Counter& counter) {
+    size_t i = 0;  // Текущая позиция в первом массиве
+    size_t j = 0;  // Текущая позиция во втором массиве
+    size_t k = 0;  // Текущая позиция в результате
+
+    counter.move(n1 + n2);  // Каждый элемент записывается в out ровно один раз
+    while (i < n1 && j < n2) {
+        counter.compare();
+        if (!comp(b[j], a[i])) {
+            out[k++] = a[i++];
+        } else {
+            out[k++] = b[j++];
+        }
+    }
+
+    // Дописываем остаток одного из массивов
+    copyElements(a + i, a + n1, out + k);
+    copyElements(b + j, b + n2, out + k + (n1 - i));
+}
+
+void mergeArrays(const int* a, size_t n1, const int* b, size_t n2, int* out) {
+    NoCounter none;
+    mergeArrays(a, n1, b, n2, out, less<int>(), none);
+}
+
+/**
+ * @brief Набор базовых примитивов сортировки слиянием
+ * 
+ * Листовая сортировка коротких блоков и слияние двух отсортированных массивов.
+ * Реализация выбирается один раз при запуске в зависимости от возможностей процессора.
+ */
+struct SortKernels {
+    const char* name;   // Название набора для вывода
+    size_t blockSize;   // Длина блока, которую сортирует sortBlock
+    // Сортирует block[0, n), n <= blockSize; scratch - буфер не короче n
+    void (*sortBlock)(int* block, size_t n, int* scratch);
+    // Сливает отсортированные a[0, n1) и b[0, n2) в out (как mergeArrays)
+    void (*merge)(const int* a, size_t n1, const int* b, size_t n2, int* out);
+};
+
+void insertionSortBlock(int* block, size_t n, int* /* scratch */) {
+    insertionSort(block, n);
+}
+
+// Скалярный набор: сортировка вставками и обычное слияние
+const SortKernels SCALAR_SORT_KERNELS = {"scalar", INSERTION_SORT_CUTOFF, insertionSortBlock, mergeArrays};
+
+#ifdef SORTING_HAS_X86_SIMD
+
+// Длина блока, который векторные наборы сортируют целиком в регистрах и L1-кэше
+const size_t SIMD_BLOCK_SIZE = 64;
+
+/*
+ * Векторные ядра построены на сортирующих сетях: сравнение-обмен двух регистров
+ * - это пара инструкций min/max без единого условного перехода, поэтому
+ * на случайных данных нет ошибок предсказания ветвлений.
+ * 
+ * Листовая сортировка блока из 64 чисел:
+ * 1. Блок загружается в регистры (8 регистров по 8 чисел для AVX2, по 4 - для SSE4.1),
+ *    сортирующая сеть сортирует "столбцы" - числа с одинаковой позицией в регистрах
+ * 2. Транспонирование превращает столбцы в строки: каждый регистр - отсортированная серия
+ * 3. Серии сливаются векторным слиянием в одну
+ * 
+ * Векторное слияние двух массивов: битоническая сеть сливает два отсортированных
+ * регистра в младшую и старшую половины; младшая записывается в результат,
+ * старшая сливается со следующим регистром из того массива, чей очередной элемент меньше.
+ */
+
+// Сравнение-обмен: после вызова a = min(a, b), b = max(a, b) поэлементно
+__attribute__((target("avx2")))
+inline void compareExchangeAvx2(__m256i& a, __m256i& b) {
+    __m256i low = _mm256_min_epi32(a, b);
+    b = _mm256_max_epi32(a, b);
+    a = low;
+}
+
+// Сортирует битоническую последовательность из 8 чисел в регистре
+__attribute__((target("avx2")))
+inline __m256i bitonicSortAvx2(__m256i v) {
+    // Сравнение элементов на расстоянии 4, 2 и 1; большие элементы уходят в старшие позиции
+    __m256i t = _mm256_permute2x128_si256(v, v, 1);
+    v = _mm256_blend_epi32(_mm256_min_epi32(v, t), _mm256_max_epi32(v, t), 0xF0);
+    t = _mm256_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+    v = _mm256_blend_epi32(_mm256_min_epi32(v, t), _mm256_max_epi32(v, t), 0xCC);
+    t = _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+    v = _mm256_blend_epi32(_mm256_min_epi32(v, t), _mm256_max_epi32(v, t), 0xAA);
+    return v;
+}
+
+// Сливает отсортированные регистры: a - 8 меньших чисел, b - 8 больших (оба по возрастанию)
+__attribute__((target("avx2")))
+inline void bitonicMergeAvx2(__m256i& a, __m256i& b) {
+    // a по возрастанию + b по убыванию = битоническая последовательность
+    b = _mm256_permutevar8x32_epi32(b, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+    compareExchangeAvx2(a, b);
+    a = bitonicSortAvx2(a);
+    b = bitonicSortAvx2(b);
+}
+
+/**
+ * @brief Сливает хвост векторного слияния: отсортированный регистр tail и остатки a и b
+ * 
+ * Хотя бы в одном из остатков меньше одного регистра чисел, поэтому сначала
+ * tail сливается с коротким остатком, а затем результат - с длинным.
+ */
+inline void mergeSimdTail(const int* tail, size_t tailSize, const int* a, size_t n1, const int* b, size_t n2, int* out) {
+    int small[32];
+    if (n1 > n2) {
+        swap(a, b);
+        swap(n1, n2);
+    }
+    mergeArrays(tail, tailSize, a, n1, small);
+    mergeArrays(small, tailSize + n1, b, n2, out);
+}
+
+__attribute__((target("avx2")))
+void mergeAvx2(const int* a, size_t n1, const int* b, size_t n2, int* out) {
+    if (n1 < 8 || n2 < 8) {
+        mergeArrays(a, n1, b, n2, out);
+        return;
+    }
+
+    __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a));
+    __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b));
+    size_t i = 8, j = 8, k = 0;
+    bitonicMergeAvx2(low, high);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), low);
+    k += 8;
+
+    // В high всегда 8 наибольших из уже загруженных чисел
+    while (i + 8 <= n1 && j + 8 <= n2) {
+        if (a[i] <= b[j]) {
+            low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+            i += 8;
+        } else {
+            low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + j));
+            j += 8;
+        }
+        bitonicMergeAvx2(low, high);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + k), low);
+        k += 8;
+    }
+
+    int tail[8];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(tail), high);
+    mergeSimdTail(tail, 8, a + i, n1 - i, b + j, n2 - j, out + k);
+}
+
+// Транспонирует матрицу 8x8 из регистров r[0..7]
+__attribute__((target("avx2")))
+inline void transpose8x8Avx2(__m256i* r) {
+    __m256i t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+    __m256i t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+    __m256i t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+    __m256i t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+    __m256i t4 = _mm256_unpacklo_epi32(r[4], r[5]);
+    __m256i t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+    __m256i t6 = _mm256_unpacklo_epi32(r[6], r[7]);
+    __m256i t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+
+    __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+    __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+    __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+    __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+    __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+    __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+    __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+    __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+
+    r[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+    r[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+    r[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+    r[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+    r[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+    r[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+    r[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+    r[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+}
+
+/**
+ * @brief Сливает серии длины width внутри блока, пока не останется одна
+ * 
+ * @return Указатель на массив (block или scratch), где оказался результат
+ */
+inline int* mergeBlockRuns(int* block, int* scratch, size_t n, size_t width,
+                           void (*merge)(const int*, size_t, const int*, size_t, int*)) {
+    int* src = block;
+    int* dst = scratch;
+    for (; width < n; width *= 2) {
+        for (size_t left = 0; left < n; left += 2 * width) {
+            size_t mid = min(left + width, n);
+            size_t right = min(left + 2 * width, n);
+            merge(src + left, mid - left, src + mid, right - mid, dst + left);
+        }
+        swap(src, dst);
+    }
+    return src;
+}
+
+__attribute__((target("avx2")))
+void sortBlockAvx2(int* block, size_t n, int* /* scratch */) {
+    if (n <= 16) {
+        insertionSort(block, n);
+        return;
+    }
+
+    // Неполный блок дополняем максимальными значениями: после сортировки они окажутся в конце
+    alignas(32) int data[SIMD_BLOCK_SIZE];
+    alignas(32) int scratch[SIMD_BLOCK_SIZE];
+    copy(block, block + n, data);
+    fill(data + n, data + SIMD_BLOCK_SIZE, numeric_limits<int>::max());
+
+    __m256i r[8];
+    for (int i = 0; i < 8; i++) {
+        r[i] = _mm256_load_si256(reinterpret_cast<const __m256i*>(data + 8 * i));
+    }
+
+    // Оптимальная сортирующая сеть для 8 входов (19 сравнений-обменов) по столбцам
+    compareExchangeAvx2(r[0], r[2]); compareExchangeAvx2(r[1], r[3]);
+    compareExchangeAvx2(r[4], r[6]); compareExchangeAvx2(r[5], r[7]);
+    compareExchangeAvx2(r[0], r[4]); compareExchangeAvx2(r[1], r[5]);
+    compareExchangeAvx2(r[2], r[6]); compareExchangeAvx2(r[3], r[7]);
+    compareExchangeAvx2(r[0], r[1]); compareExchangeAvx2(r[2], r[3]);
+    compareExchangeAvx2(r[4], r[5]); compareExchangeAvx2(r[6], r[7]);
+    compareExchangeAvx2(r[2], r[4]); compareExchangeAvx2(r[3], r[5]);
+    compareExchangeAvx2(r[1], r[4]); compareExchangeAvx2(r[3], r[6]);
+    compareExchangeAvx2(r[1], r[2]); compareExchangeAvx2(r[3], r[4]); compareExchangeAvx2(r[5], r[6]);
+
+    transpose8x8Avx2(r);
+    for (int i = 0; i < 8; i++) {
+        _mm256_store_si256(reinterpret_cast<__m256i*>(data + 8 * i), r[i]);
+    }
+
+    int* sorted = mergeBlockRuns(data, scratch, SIMD_BLOCK_SIZE, 8, mergeAvx2);
+    copy(sorted, sorted + n, block);
+}
+
+__attribute__((target("sse4.1")))
+inline void compareExchangeSse(__m128i& a, __m128i& b) {
+    __m128i low = _mm_min_epi32(a, b);
+    b = _mm_max_epi32(a, b);
+    a = low;
+}
+
+// Сортирует битоническую последовательность из 4 чисел в регистре
+__attribute__((target("sse4.1")))
+inline __m128i bitonicSortSse(__m128i v) {
+    __m128i t = _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+    v = _mm_blend_epi16(_mm_min_epi32(v, t), _mm_max_epi32(v, t), 0xF0);
+    t = _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+    v = _mm_blend_epi16(_mm_min_epi32(v, t), _mm_max_epi32(v, t), 0xCC);
+    return v;
+}
+
+__attribute__((target("sse4.1")))
+inline void bitonicMergeSse(__m128i& a, __m128i& b) {
+    b = _mm_shuffle_epi32(b, _MM_SHUFFLE(0, 1, 2, 3));
+    compareExchangeSse(a, b);
+    a = bitonicSortSse(a);
+    b = bitonicSortSse(b);
+}
+
+__attribute__((target("sse4.1")))
+void mergeSse(const int* a, size_t n1, const int* b, size_t n2, int* out) {
+    if (n1 < 4 || n2 < 4) {
+        mergeArrays(a, n1, b, n2, out);
+        return;
+    }
+
+    __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a));
+    __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+    size_t i = 4, j = 4, k = 0;
+    bitonicMergeSse(low, high);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), low);
+    k += 4;
+
+    while (i + 4 <= n1 && j + 4 <= n2) {
+        if (a[i] <= b[j]) {
+            low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+            i += 4;
+        } else {
+            low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + j));
+            j += 4;
+        }
+        bitonicMergeSse(low, high);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + k), low);
+        k += 4;
+    }
+
+    int tail[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(tail), high);
+    mergeSimdTail(tail, 4, a + i, n1 - i, b + j, n2 - j, out + k);
+}
+
+__attribute__((target("sse4.1")))
+void sortBlockSse(int* block, size_t n, int* /* scratch */) {
+    if (n <= 16) {
+        insertionSort(block, n);
+        return;
+    }
+
+    alignas(16) int data[SIMD_BLOCK_SIZE];
+    alignas(16) int scratch[SIMD_BLOCK_SIZE];
+    copy(block, block + n, data);
+    fill(data + n, data + SIMD_BLOCK_SIZE, numeric_limits<int>::max());
+
+    // Блок обрабатывается группами по 4 регистра: сеть для 4 входов + транспонирование 4x4
+    for (size_t group = 0; group < SIMD_BLOCK_SIZE; group += 16) {
+        __m128i r0 = _mm_load_si128(reinterpret_cast<const __m128i*>(data + group));
+        __m128i r1 = _mm_load_si128(reinterpret_cast<const __m128i*>(data + group + 4));
+        __m128i r2 = _mm_load_si128(reinterpret_cast<const __m128i*>(data + group + 8));
+        __m128i r3 = _mm_load_si128(reinterpret_cast<const __m128i*>(data + group + 12));
+
+        compareExchangeSse(r0, r1); compareExchangeSse(r2, r3);
+        compareExchangeSse(r0, r2); compareExchangeSse(r1, r3);
+        compareExchangeSse(r1, r2);
+
+        __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+        __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+        __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+        __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+        _mm_store_si128(reinterpret_cast<__m128i*>(data + group), _mm_unpacklo_epi64(t0, t1));
+        _mm_store_si128(reinterpret_cast<__m128i*>(data + group + 4), _mm_unpackhi_epi64(t0, t1));
+        _mm_store_si128(reinterpret_cast<__m128i*>(data + group + 8), _mm_unpacklo_epi64(t2, t3));
+        _mm_store_si128(reinterpret_cast<__m128i*>(data + group + 12), _mm_unpackhi_epi64(t2, t3));
+    }
+
+    int* sorted = mergeBlockRuns(data, scratch, SIMD_BLOCK_SIZE, 4, mergeSse);
+    copy(sorted, sorted + n, block);
+}
+
+const SortKernels AVX2_SORT_KERNELS = {"avx2", SIMD_BLOCK_SIZE, sortBlockAvx2, mergeAvx2};
+const SortKernels SSE41_SORT_KERNELS = {"sse4.1", SIMD_BLOCK_SIZE, sortBlockSse, mergeSse};
+
+#endif  // SORTING_HAS_X86_SIMD
+
+// Выбирает лучший набор примитивов, поддерживаемый процессором
+const SortKernels* detectSortKernels() {
+#ifdef SORTING_HAS_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return &AVX2_SORT_KERNELS;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return &SSE41_SORT_KERNELS;
+    }
+#endif
+    return &SCALAR_SORT_KERNELS;
+}
+
+// Хранит текущий набор примитивов (определяется при первом обращении)
+const SortKernels*& sortKernelsSlot() {
+    static const SortKernels* kernels = detectSortKernels();
+    return kernels;
+}
+
+// Текущий набор примитивов сортировки слиянием
+const SortKernels& activeSortKernels() {
+    return *sortKernelsSlot();
+}
+
+// Отключает векторные примитивы (например, для сравнения производительности)
+void useScalarSortKernels() {
+    sortKernelsSlot() = &SCALAR_SORT_KERNELS;
+}
+
+/**
+ * @brief Итеративная (восходящая) сортировка прямым слиянием с одним вспомогательным буфером
+ * 
+ * Делает то же, что и mergeSort(), но без рекурсии и без выделения памяти при каждом слиянии:
+ * 1. Блоки по blockSize элементов сортируются листовой сортировкой sortBlock
+ *    (вставками или векторной сортирующей сетью)
+ * 2. Соседние участки попарно сливаются функцией merge, ширина участка удваивается на каждом проходе
+ * 3. Проходы по очереди пишут то в buffer, то обратно в data ("пинг-понг"),
+ *    поэтому на каждом проходе элементы копируются ровно один раз
+ * 
+ * @param data Массив для сортировки
+ * @param buffer Вспомогательный буфер не короче data
+ * @param n Количество элементов
+ */
+template <typename T, typename SortBlock, typename Merge, typename Counter>
+void mergeSortBottomUpWith(T* data, T* buffer, size_t n, size_t blockSize,
+                           SortBlock sortBlock, Merge merge, Counter& counter) {
+    if (n < 2) {
+        return;
+    }
+
+    // Сортируем короткие блоки листовой сортировкой
+    for (size_t left = 0; left < n; left += blockSize) {
+        sortBlock(data + left, min(blockSize, n - left), buffer + left);
+    }
+
+    T* src = data;    // Откуда читаем на текущем проходе
+    T* dst = buffer;  // Куда пишем на текущем проходе
+
+    for (size_t width = blockSize; width < n; width *= 2) {
+        for (size_t left = 0; left < n; left += 2 * width) {
+            size_t mid = min(left + width, n);
+            size_t right = min(left + 2 * width, n);
+            // Если второго участка нет, слияние просто перенесет первый в dst
+            merge(src + left, mid - left, src + mid, right - mid, dst + left);
+        }
+        swap(src, dst);  // Результат прохода становится источником для следующего
+    }
+
+    // После нечетного числа проходов результат лежит в буфере
+    if (src != data) {
+        copyElements(src, src + n, data);
+        counter.move(n);
+    }
+}
+
+/**
+ * @brief Восходящая сортировка слиянием массива data[0, n) с буфером buffer
+ * 
+ * Выбор реализации делается при компиляции: int по возрастанию без подсчета операций
+ * сортируется текущим набором примитивов activeSortKernels() (сортирующие сети SSE4.1/AVX2),
+ * все остальные типы и сравнения - скалярными вставками и слиянием с comp.
+ */
+template <typename T, typename Compare, typename Counter>
+void mergeSortWithBuffer(T* data, T* buffer, size_t n, Compare comp, Counter& counter) {
+    if constexpr (USES_INT_KERNELS<T, Compare> && is_same<Counter, NoCounter>::value) {
+        const SortKernels& kernels = activeSortKernels();
+        mergeSortBottomUpWith(data, buffer, n, kernels.blockSize, kernels.sortBlock, kernels.merge, counter);
+    } else {
+        mergeSortBottomUpWith(
+            data, buffer, n, INSERTION_SORT_CUTOFF,
+            [&](T* block, size_t length, T*) { insertionSort(block, length, comp, counter); },
+            [&](const T* a, size_t n1, const T* b, size_t n2, T* out) { mergeArrays(a, n1, b, n2, out, comp, counter); },
+            counter);
+    }
+}
+
+template <typename T, typename Compare = less<T>>
+void mergeSortWithBuffer(T* data, T* buffer, size_t n, Compare comp = Compare()) {
+    NoCounter none;
+    mergeSortWithBuffer(data, buffer, n, comp, none);
+}
+
+/**
+ * @brief Сортирует диапазон [first, last) восходящей сортировкой слиянием
+ * 
+ * Вспомогательный буфер выделяется один раз на всю сортировку.
+ * Результат совпадает с mergeSort(first, last, comp).
+ * 
+ * @param first Начало сортируемого диапазона
+ * @param last Конец сортируемого диапазона
+ * @param comp Сравнение элементов ("меньше")
+ * @param counter Счетчик операций
+ */
+template <typename RandomIt, typename Compare, typename Counter>
+void mergeSortBottomUp(RandomIt first, RandomIt last, Compare comp, Counter& counter) {
+    using T = ValueOf<RandomIt>;
+    sortContiguous(first, last, [&](T* data, size_t n) {
+        vector<T> buffer(n);
+        mergeSortWithBuffer(data, buffer.data(), n, comp, counter);
+    });
+}
+
+template <typename RandomIt, typename Compare = DefaultLess<RandomIt>>
+void mergeSortBottomUp(RandomIt first, RandomIt last, Compare comp = Compare()) {
+    NoCounter none;
+    mergeSortBottomUp(first, last, comp, none);
+}
+
+/**
+ * @brief Пул потоков с перехватом задач (work stealing)
+ * 
+ * У каждого потока своя очередь задач. Поток берет задачи из конца своей очереди
+ * (последние добавленные - их данные еще в кэше), а когда она пуста - "крадет"
+ * самые старые (и обычно самые крупные) задачи из начала чужих очередей.
+ * Очередь с индексом 0 принадлежит потоку, создавшему пул: он тоже выполняет
+ * задачи, пока ждет их завершения в TaskGroup::wait().
+ */
+class WorkStealingPool {
+public:
+    /**
+     * @param threadCount Общее число потоков, включая вызывающий
+     */
+    explicit WorkStealingPool(size_t threadCount) : stopping(false), queuedTasks(0) {
+        threadCount = max<size_t>(threadCount, 1);
+        for (size_t i = 0; i < threadCount; i++) {
+            queues.push_back(make_unique<WorkerQueue>());
+        }
+        // Вызывающий поток занимает очередь 0, остальным создаем рабочие потоки
+        for (size_t i = 1; i < threadCount; i++) {
+            workers.emplace_back([this, i] { workerLoop(i); });
+        }
+    }
+
+    ~WorkStealingPool() {
+        {
+            lock_guard<mutex> guard(idleMutex);
+            stopping = true;
+        }
+        idleCondition.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    // Общее число потоков пула
+    size_t size() const {
+        return queues.size();
+    }
+
+    /**
+     * @brief Добавляет задачу в очередь текущего потока
+     */
+    void submit(function<void()> task) {
+        WorkerQueue& queue = *queues[currentQueueIndex()];
+        {
+            lock_guard<mutex> guard(queue.lock);
+            queue.tasks.push_back(move(task));
+        }
+        {
+            // Увеличиваем счетчик под мьютексом, чтобы спящий поток не пропустил пробуждение
+            lock_guard<mutex> guard(idleMutex);
+            queuedTasks++;
+        }
+        idleCondition.notify_one();
+    }
+
+    /**
+     * @brief Выполняет одну задачу из своей очереди или украденную у другого потока
+     * 
+     * @return true если задача была выполнена, false если все очереди пусты
+     */
+    bool runPendingTask() {
+        function<void()> task;
+        if (!takeTask(currentQueueIndex(), task)) {
+            return false;
+        }
+        task();
+        return true;
+    }
+
+private:
+    struct WorkerQueue {
+        mutex lock;
+        deque<function<void()>> tasks;
+    };
+
+    vector<unique_ptr<WorkerQueue>> queues;
+    vector<thread> workers;
+
+    mutex idleMutex;                    // Защищает stopping и queuedTasks для ожидания
+    condition_variable idleCondition;   // На нем спят потоки, которым нечего делать
+    bool stopping;
+    size_t queuedTasks;                 // Число задач, лежащих в очередях
+
+    static thread_local size_t workerIndex;  // Индекс очереди текущего потока (0 - вызывающий)
+
+    size_t currentQueueIndex() const {
+        return workerIndex < queues.size() ? workerIndex : 0;
+    }
+
+    // Берем задачу из конца своей очереди, иначе крадем из начала чужих
+    bool takeTask(size_t self, function<void()>& task) {
+        {
+            WorkerQueue& own = *queues[self];
+            lock_guard<mutex> guard(own.lock);
+            if (!own.tasks.empty()) {
+                task = move(own.tasks.back());
+                own.tasks.pop_back();
+                onTaskTaken();
+                return true;
+            }
+        }
+        for (size_t offset = 1; offset < queues.size(); offset++) {
+            WorkerQueue& victim = *queues[(self + offset) % queues.size()];
+            lock_guard<mutex> guard(victim.lock);
+            if (!victim.tasks.empty()) {
+                task = move(victim.tasks.front());
+                victim.tasks.pop_front();
+                onTaskTaken();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void onTaskTaken() {
+        lock_guard<mutex> guard(idleMutex);
+        queuedTasks--;
+    }
+
+    void workerLoop(size_t index) {
+        workerIndex = index;
+        while (true) {
+            if (runPendingTask()) {
+                continue;
+            }
+            unique_lock<mutex> guard(idleMutex);
+            idleCondition.wait(guard, [this] { return stopping || queuedTasks > 0; });
+            if (stopping) {
+                return;
+            }
+        }
+    }
+};
+
+thread_local size_t WorkStealingPool::workerIndex = 0;
+
+/**
+ * @brief Группа задач, завершения которых можно дождаться
+ * 
+ * Ожидающий поток не простаивает, а выполняет задачи пула - так вложенные
+ * (рекурсивные) группы не блокируют друг друга.
+ */
+class TaskGroup {
+public:
+    explicit TaskGroup(WorkStealingPool& workerPool) : pool(workerPool), pending(0) {}
+
+    ~TaskGroup() {
+        wait();
+    }
+
+    // Запускает задачу в пуле
+    void run(function<void()> task) {
+        pending++;
+        pool.submit([this, task = move(task)] {
+            task();
+            pending--;
+        });
+    }
+
+    // Ждет завершения всех задач группы, помогая их выполнять
+    void wait() {
+        while (pending > 0) {
+            if (!pool.runPendingTask()) {
+                this_thread::yield();
+            }
+        }
+    }
+
+private:
+    WorkStealingPool& pool;
+    atomic<size_t> pending;
+};
+
+// Участки короче этого значения сортируются последовательно
+const size_t PARALLEL_SORT_GRAIN = 1 << 14;
+// Слияния короче этого значения выполняются последовательно
+const size_t PARALLEL_MERGE_GRAIN = 1 << 15;
+
+/**
+ * @brief Находит, сколько элементов a попадает в первые k элементов слияния a и b (co-rank)
+ * 
+ * Бинарный поиск по i такого, что i элементов из a и k - i элементов из b
+ * образуют ровно первые k элементов устойчивого слияния (как в mergeArrays()).
+ */
+template <typename T, typename Compare>
+size_t coRank(size_t k, const T* a, size_t n1, const T* b, size_t n2, Compare comp) {
+    size_t low = k > n2 ? k - n2 : 0;
+    size_t high = min(k, n1);
+    while (low < high) {
+        size_t i = low + (high - low) / 2;
+        size_t j = k - i;
+        // Если a[i] <= b[j - 1], то a[i] должен попасть в результат раньше b[j - 1] - i мало
+        if (!comp(b[j - 1], a[i])) {
+            low = i + 1;
+        } else {
+            high = i;
+        }
+    }
+    return low;
+}
+
+// Последовательное слияние: векторные примитивы для int, скалярное слияние для остальных типов
+template <typename T, typename Compare>
+void sequentialMerge(const T* a, size_t n1, const T* b, size_t n2, T* out, Compare comp) {
+    if constexpr (USES_INT_KERNELS<T, Compare>) {
+        activeSortKernels().merge(a, n1, b, n2, out);
+    } else {
+        NoCounter none;
+        mergeArrays(a, n1, b, n2, out, comp, none);
+    }
+}
+
+/**
+ * @brief Параллельно сливает отсортированные массивы a и b в out
+ * 
+ * Результат делится на равные куски, для границы каждого куска coRank() находит
+ * соответствующие позиции в a и b, после чего куски сливаются независимо.
+ */
+template <typename T, typename Compare>
+void parallelMerge(WorkStealingPool& pool, const T* a, size_t n1, const T* b, size_t n2, T* out, Compare comp) {
+    size_t total = n1 + n2;
+    if (total <= PARALLEL_MERGE_GRAIN || pool.size() == 1) {
+        sequentialMerge(a, n1, b, n2, out, comp);
+        return;
+    }
+
+    // Несколько кусков на поток, чтобы перехват задач выравнивал нагрузку
+    size_t pieces = min(pool.size() * 4, total / PARALLEL_MERGE_GRAIN);
+    TaskGroup group(pool);
+    for (size_t p = 0; p < pieces; p++) {
+        group.run([=] {
+            size_t k0 = total * p / pieces;
+            size_t k1 = total * (p + 1) / pieces;
+            size_t i0 = coRank(k0, a, n1, b, n2, comp);
+            size_t i1 = coRank(k1, a, n1, b, n2, comp);
+            sequentialMerge(a + i0, i1 - i0, b + (k0 - i0), (k1 - i1) - (k0 - i0), out + k0, comp);
+        });
+    }
+    group.wait();
+}
+
+/**
+ * @brief Рекурсивная часть параллельной сортировки слиянием
+ * 
+ * Сортирует data[0, n); результат оказывается в buffer, если toBuffer, иначе в data.
+ * Половины сортируются в противоположный массив, поэтому слияние верхнего уровня
+ * сразу пишет туда, где результат должен оказаться, без лишних копирований.
+ */
+template <typename T, typename Compare>
+void parallelSortInto(WorkStealingPool& pool, T* data, T* buffer, size_t n, bool toBuffer, Compare comp) {
+    if (n <= PARALLEL_SORT_GRAIN) {
+        mergeSortWithBuffer(data, buffer, n, comp);
+        if (toBuffer) {
+            copyElements(data, data + n, buffer);
+        }
+        return;
+    }
+
+    size_t half = n / 2;
+    {
+        TaskGroup group(pool);
+        group.run([&] { parallelSortInto(pool, data, buffer, half, !toBuffer, comp); });
+        parallelSortInto(pool, data + half, buffer + half, n - half, !toBuffer, comp);
+        group.wait();
+    }
+
+    const T* src = toBuffer ? data : buffer;
+    T* dst = toBuffer ? buffer : data;
+    parallelMerge(pool, src, half, src + half, n - half, dst, comp);
+}
+
+/**
+ * @brief Параллельная сортировка слиянием на пуле потоков с перехватом задач
+ * 
+ * Рекурсия разбивается на задачи пула, верхние (самые длинные) слияния тоже
+ * выполняются параллельно через parallelMerge(). Результат совпадает с mergeSort().
+ * 
+ * @param first Начало сортируемого диапазона
+ * @param last Конец сортируемого диапазона
+ * @param threadCount Число потоков
+ * @param comp Сравнение элементов ("меньше")
+ */
+template <typename RandomIt, typename Compare = DefaultLess<RandomIt>>
+void parallelMergeSort(RandomIt first, RandomIt last, size_t threadCount, Compare comp = Compare()) {
+    using T = ValueOf<RandomIt>;
+    sortContiguous(first, last, [&](T* data, size_t n) {
+        vector<T> buffer(n);
+        WorkStealingPool pool(threadCount);
+        parallelSortInto(pool, data, buffer.data(), n, false, comp);
+    });
+}
+
+// Минимальное число подряд "побед" одной серии, после которого слияние переходит в режим галопа
+const size_t MIN_GALLOP = 7;
+
+/**
+ * @brief Вычисляет минимальную длину серии для естественной сортировки слиянием
+ * 
+ * Результат лежит в диапазоне [32, 64] и подобран так, чтобы n / minRun было равно
+ * степени двойки или чуть меньше ее - тогда слияния получаются сбалансированными.
+ */
+size_t computeMinRun(size_t n) {
+    size_t extra = 0;  // Станет 1, если среди отброшенных битов была единица
+    while (n >= 64) {
+        extra |= n & 1;
+        n >>= 1;
+    }
+    return n + extra;
+}
+
+/**
+ * @brief Находит серию, начинающуюся с позиции left, и делает ее неубывающей
+ * 
+ * Неубывающая серия остается как есть, строго убывающая переворачивается
+ * (строгость нужна, чтобы переворот не нарушил порядок равных элементов).
+ * 
+ * @return Длина найденной серии
+ */
+template <typename T, typename Compare, typename Counter>
+size_t findRunAndMakeAscending(T* arr, size_t left, size_t right, Compare comp, Counter& counter) {
+    size_t end = left + 1;
+    if (end == right) {
+        return 1;
+    }
+
+    counter.compare();
+    if (comp(arr[end], arr[left])) {
+        // Строго убывающая серия
+        while (end + 1 < right) {
+            counter.compare();
+            if (!comp(arr[end + 1], arr[end])) {
+                break;
+            }
+            end++;
+        }
+        reverse(arr + left, arr + end + 1);
+        counter.move(3 * ((end + 1 - left) / 2));  // Каждый обмен - три присваивания
+    } else {
+        // Неубывающая серия
+        while (end + 1 < right) {
+            counter.compare();
+            if (comp(arr[end + 1], arr[end])) {
+                break;
+            }
+            end++;
+        }
+    }
+    return end + 1 - left;
+}
+
+// Сравнение comp, которое учитывается в счетчике операций
+template <typename Compare, typename Counter>
+auto countedLess(Compare comp, Counter& counter) {
+    return [comp, &counter](const auto& a, const auto& b) {
+        counter.compare();
+        return comp(a, b);
+    };
+}
+
+/**
+ * @brief Сортировка вставками с бинарным поиском места, если arr[left, sortedEnd) уже отсортирован
+ */
+template <typename T, typename Compare, typename Counter>
+void binaryInsertionSort(T* arr, size_t left, size_t right, size_t sortedEnd, Compare comp, Counter& counter) {
+    auto less = countedLess(comp, counter);
+    for (size_t i = sortedEnd; i < right; i++) {
+        T value = std::move(arr[i]);
+        // upper_bound сохраняет устойчивость: новый элемент встает после равных ему
+        T* position = upper_bound(arr + left, arr + i, value, less);
+        move_backward(position, arr + i, arr + i + 1);
+        *position = std::move(value);
+        counter.move((arr + i - position) + 2);
+    }
+}
+
+/**
+ * @brief Экспоненциальный поиск: сколько элементов arr[0, n) не больше key (аналог upper_bound)
+ * 
+ * Сначала шагами 1, 3, 7, 15... находится интервал, содержащий ответ, затем
+ * выполняется бинарный поиск внутри него. Если ответ близок к началу массива,
+ * это O(log k) сравнений вместо O(log n).
+ */
+template <typename T, typename Compare, typename Counter>
+size_t gallopRight(const T& key, const T* arr, size_t n, Compare comp, Counter& counter) {
+    auto less = countedLess(comp, counter);
+    size_t previous = 0;
+    size_t offset = 1;
+    while (offset < n && !less(key, arr[offset - 1])) {
+        previous = offset;
+        offset = offset * 2 + 1;
+    }
+    return upper_bound(arr + previous, arr + min(offset, n), key, less) - arr;
+}
+
+/**
+ * @brief Экспоненциальный поиск: сколько элементов arr[0, n) меньше key (аналог lower_bound)
+ */
+template <typename T, typename Compare, typename Counter>
+size_t gallopLeft(const T& key, const T* arr, size_t n, Compare comp, Counter& counter) {
+    auto less = countedLess(comp, counter);
+    size_t previous = 0;
+    size_t offset = 1;
+    while (offset < n && less(arr[offset - 1], key)) {
+        previous = offset;
+        offset = offset * 2 + 1;
+    }
+    return lower_bound(arr + previous, arr + min(offset, n), key, less) - arr;
+}
+
+/**
+ * @brief Сливает соседние серии arr[left, mid) и arr[mid, right) с галопом
+ * 
+ * Сначала отбрасываются элементы, которые уже стоят на своих местах: начало левой
+ * серии, не превосходящее arr[mid], и конец правой серии, не меньший arr[mid - 1].
+ * Если одна серия выигрывает MIN_GALLOP раз подряд, слияние переходит в режим галопа
+ * и переносит целые блоки, найденные экспоненциальным поиском.
+ * 
+ * @param buffer Вспомогательный буфер не короче левой серии
+ */
+template <typename T, typename Compare, typename Counter>
+void gallopingMerge(T* arr, size_t left, size_t mid, size_t right, T* buffer, Compare comp, Counter& counter) {
+    // Элементы левой серии, не превосходящие первого элемента правой, уже на месте
+    left += gallopRight(arr[mid], arr + left, mid - left, comp, counter);
+    if (left == mid) {
+        return;
+    }
+    // Элементы правой серии, не меньшие последнего элемента левой, тоже на месте
+    right = mid + gallopLeft(arr[mid - 1], arr + mid, right - mid, comp, counter);
+
+    size_t n1 = mid - left;
+    copyElements(arr + left, arr + mid, buffer);
+    // Копия в буфер и запись каждого элемента на итоговое место
+    counter.move(n1 + (right - left));
+
+    const T* a = buffer;  // Левая серия (в буфере)
+    size_t i = 0;
+    size_t j = mid;       // Правая серия читается на месте
+    size_t k = left;      // Позиция записи никогда не обгоняет j
+
+    size_t winsA = 0;  // Сколько раз подряд выиграла левая серия
+    size_t winsB = 0;  // Сколько раз подряд выиграла правая серия
+    while (i < n1 && j < right) {
+        counter.compare();
+        if (comp(arr[j], a[i])) {
+            arr[k++] = arr[j++];
+            winsB++;
+            winsA = 0;
+        } else {
+            arr[k++] = a[i++];
+            winsA++;
+            winsB = 0;
+        }
+
+        if (winsA >= MIN_GALLOP || winsB >= MIN_GALLOP) {
+            // Режим галопа: переносим блоки, пока они достаточно длинные
+            size_t countA, countB;
+            do {
+                if (i == n1 || j == right) {
+                    break;
+                }
+                countA = gallopRight(arr[j], a + i, n1 - i, comp, counter);
+                copyElements(a + i, a + i + countA, arr + k);
+                i += countA;
+                k += countA;
+                if (i == n1) {
+                    break;
+                }
+
+                // Источник и приемник могут перекрываться (k <= j), поэтому не memcpy
+                countB = gallopLeft(a[i], arr + j, right - j, comp, counter);
+                copy(arr + j, arr + j + countB, arr + k);
+                j += countB;
+                k += countB;
+            } while (countA >= MIN_GALLOP || countB >= MIN_GALLOP);
+            winsA = 0;
+            winsB = 0;
+        }
+    }
+
+    // Остаток правой серии уже на месте, дописываем остаток левой
+    copyElements(a + i, a + n1, arr + k);
+}
+
+/**
+ * @brief Естественная (адаптивная) сортировка слиянием массива data[0, n)
+ * 
+ * В отличие от прямого слияния, использует порядок, который уже есть в данных:
+ * 1. Массив разбивается на естественные серии - неубывающие и строго убывающие
+ *    (последние переворачиваются); короткие серии дополняются вставками до minRun
+ * 2. Серии складываются в стек, и соседние серии сливаются так, чтобы длины
+ *    в стеке убывали быстрее чисел Фибоначчи - это держит слияния сбалансированными
+ * 3. Слияние использует галоп, поэтому частично упорядоченные данные сливаются быстро
+ * 
+ * Уже отсортированный (или отсортированный по убыванию) массив - это одна серия,
+ * и сортировка занимает O(n).
+ */
+template <typename T, typename Compare, typename Counter>
+void naturalMergeSortArray(T* data, size_t n, Compare comp, Counter& counter) {
+    size_t minRun = computeMinRun(n);
+    vector<T> buffer;                         // Выделяется при первом слиянии
+    vector<pair<size_t, size_t>> runs;        // Стек серий: (начало, длина)
+
+    auto mergeAt = [&](size_t index) {
+        size_t start = runs[index].first;
+        size_t length1 = runs[index].second;
+        size_t length2 = runs[index + 1].second;
+        if (buffer.size() < length1) {
+            buffer.resize(n);
+        }
+        gallopingMerge(data, start, start + length1, start + length1 + length2, buffer.data(), comp, counter);
+        runs[index].second = length1 + length2;
+        runs.erase(runs.begin() + index + 1);
+    };
+
+    // Восстанавливает инварианты стека: len[i-2] > len[i-1] + len[i] и len[i-1] > len[i]
+    auto collapse = [&] {
+        while (runs.size() > 1) {
+            size_t top = runs.size() - 2;
+            auto length = [&](size_t i) { return runs[i].second; };
+            if ((top > 0 && length(top - 1) <= length(top) + length(top + 1)) ||
+                (top > 1 && length(top - 2) <= length(top - 1) + length(top))) {
+                if (top > 0 && length(top - 1) < length(top + 1)) {
+                    top--;
+                }
+                mergeAt(top);
+            } else if (length(top) <= length(top + 1)) {
+                mergeAt(top);
+            } else {
+                break;
+            }
+        }
+    };
+
+    size_t position = 0;
+    while (position < n) {
+        size_t runLength = findRunAndMakeAscending(data, position, n, comp, counter);
+
+        // Слишком короткую серию дополняем до minRun вставками
+        if (runLength < minRun) {
+            size_t forced = min(minRun, n - position);
+            binaryInsertionSort(data, position, position + forced, position + runLength, comp, counter);
+            runLength = forced;
+        }
+
+        runs.push_back({position, runLength});
+        collapse();
+        position += runLength;
+    }
+
+    // Сливаем все оставшиеся серии
+    while (runs.size() > 1) {
+        size_t top = runs.size() - 2;
+        if (top > 0 && runs[top - 1].second < runs[top + 1].second) {
+            top--;
+        }
+        mergeAt(top);
+    }
+}
+
+/**
+ * @brief Естественная сортировка слиянием диапазона [first, last), см. naturalMergeSortArray()
+ * 
+ * @param first Начало сортируемого диапазона
+ * @param last Конец сортируемого диапазона
+ * @param comp Сравнение элементов ("меньше")
+ * @param counter Счетчик операций
+ */
+template <typename RandomIt, typename Compare, typename Counter>
+void naturalMergeSort(RandomIt first, RandomIt last, Compare comp, Counter& counter) {
+    using T = ValueOf<RandomIt>;
+    sortContiguous(first, last, [&](T* data, size_t n) { naturalMergeSortArray(data, n, comp, counter); });
+}
+
+template <typename RandomIt, typename Compare = DefaultLess<RandomIt>>
+void naturalMergeSort(RandomIt first, RandomIt last, Compare comp = Compare()) {
+    NoCounter none;
+    naturalMergeSort(first, last, comp, none);
+}
+
+// Ширина разряда поразрядной сортировки в битах: для 32-битных ключей 3 прохода по 11, 11 и 10 бит
+const unsigned RADIX_BITS = 11;
+const size_t RADIX_BUCKETS = size_t(1) << RADIX_BITS;
+
+// Поразрядная сортировка применима к целым типам (кроме bool)
+template <typename T>
+constexpr bool IS_RADIX_SORTABLE = is_integral<T>::value && !is_same<T, bool>::value;
+
+/**
+ * @brief Поразрядная сортировка LSD (от младших разрядов к старшим)
+ * 
+ * Сортировка без сравнений, O(n) для целочисленных ключей любой ширины:
+ * 1. У знаковых типов инвертируется знаковый бит, чтобы отрицательные числа
+ *    как беззнаковые оказались меньше положительных
+ * 2. За один проход по массиву строятся гистограммы сразу для всех разрядов
+ * 3. Для каждого разряда (начиная с младшего) числа устойчиво раскладываются
+ *    по корзинам в буфер; массив и буфер меняются ролями
+ * 4. Проход пропускается, если все числа имеют одинаковое значение разряда
+ *    (например, старший разряд у чисел из небольшого диапазона)
+ * 
+ * @param arr Массив для сортировки
+ * @param n Количество элементов
+ * @param counter Счетчик операций
+ */
+template <typename T, typename Counter>
+void radixSortArray(T* arr, size_t n, Counter& counter) {
+    static_assert(IS_RADIX_SORTABLE<T>, "radixSort сортирует только целые числа");
+    using Key = typename make_unsigned<T>::type;
+    const unsigned KEY_BITS = sizeof(Key) * 8;
+    const unsigned PASSES = (KEY_BITS + RADIX_BITS - 1) / RADIX_BITS;
+    const Key SIGN_BIT = is_signed<T>::value ? Key(Key(1) << (KEY_BITS - 1)) : Key(0);
+
+    // Знаковый и беззнаковый типы могут обращаться к одной памяти, поэтому ключи обрабатываются на месте
+    Key* keys = reinterpret_cast<Key*>(arr);
+    vector<Key> buffer(n);
+    vector<size_t> counts(PASSES * RADIX_BUCKETS, 0);
+
+    // Один проход: переворот знака и гистограммы всех разрядов
+    for (size_t i = 0; i < n; i++) {
+        Key key = keys[i] ^ SIGN_BIT;
+        keys[i] = key;
+        counter.move();
+        for (unsigned pass = 0; pass < PASSES; pass++) {
+            counts[pass * RADIX_BUCKETS + ((key >> (pass * RADIX_BITS)) & (RADIX_BUCKETS - 1))]++;
+        }
+    }
+
+    Key* src = keys;
+    Key* dst = buffer.data();
+    for (unsigned pass = 0; pass < PASSES; pass++) {
+        size_t* count = counts.data() + pass * RADIX_BUCKETS;
+        unsigned shift = pass * RADIX_BITS;
+
+        // Все числа в одной корзине - проход ничего не изменит
+        if (count[(src[0] >> shift) & (RADIX_BUCKETS - 1)] == n) {
+            continue;
+        }
+
+        // Превращаем гистограмму в начальные позиции корзин
+        size_t offset = 0;
+        for (size_t bucket = 0; bucket < RADIX_BUCKETS; bucket++) {
+            size_t c = count[bucket];
+            count[bucket] = offset;
+            offset += c;
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            Key key = src[i];
+            dst[count[(key >> shift) & (RADIX_BUCKETS - 1)]++] = key;
+        }
+        counter.move(n);
+        swap(src, dst);
+    }
+
+    // Возвращаем знаковый бит на место (и результат в arr, если он оказался в буфере)
+    for (size_t i = 0; i < n; i++) {
+        keys[i] = src[i] ^ SIGN_BIT;
+    }
+    counter.move(n);
+}
+
+// Поразрядная сортировка диапазона [first, last) целых чисел, см. radixSortArray()
+template <typename RandomIt, typename Counter>
+void radixSort(RandomIt first, RandomIt last, Counter& counter) {
+    using T = ValueOf<RandomIt>;
+    sortContiguous(first, last, [&](T* data, size_t n) { radixSortArray(data, n, counter); });
+}
+
+template <typename RandomIt>
+void radixSort(RandomIt first, RandomIt last) {
+    NoCounter none;
+    radixSort(first, last, none);
+}
+
+/**
+ * @brief Реализует алгоритм шейкерной (коктейльной) сортировки
+ * 
+ * Шейкерная сортировка - это вариация пузырьковой сортировки, которая сортирует в обоих направлениях.
+ * Она работает путем:
+ * 1. Перемещения наибольших элементов в конец (проход справа налево)
+ * 2. Затем перемещения наименьших элементов в начало (проход слева направо)
+ * 3. Повторения этих действий, пока массив не будет отсортирован
+ * 
+ * Этот двунаправленный подход может быть более эффективным, чем стандартная пузырьковая сортировка
+ * для определенных распределений данных.
+ * 
+ * @param first Начало сортируемого диапазона
+ * @param last Конец сортируемого диапазона
+ * @param comp Сравнение элементов ("меньше")
+ * @param counter Счетчик операций
+ */
+template <typename RandomIt, typename Compare, typename Counter>
+void shakerSort(RandomIt first, RandomIt last, Compare comp, Counter& counter) {
+    size_t n = static_cast<size_t>(last - first);
+    if (n < 2) {
+        return;
+    }
+
+    bool swapped = true;
+    size_t start = 0;
+    size_t end = n - 1;
+
+    while (swapped) {
+        // Сбрасываем флаг обмена для первого прохода
+        swapped = false;
+
+        // Прямой проход (слева направо) - как при пузырьковой сортировке
+        // Перемещаем наибольший элемент в конец
+        for (size_t i = start; i < end; ++i) {
+            counter.compare();
+            if (comp(first[i + 1], first[i])) {
+                iter_swap(first + i, first + i + 1);
+                counter.move(3);
+                swapped = true;
+            }
+        }
+
+        // Если ничего не переместилось, массив отсортирован
+        if (!swapped)
+            break;
+
+        // Сбрасываем флаг обмена для обратного прохода
+        swapped = false;
+        
+        // Перемещаем конечную точку на одну позицию назад
+        // (наибольший элемент уже на своем месте)
+        --end;
+
+        // Обратный проход (справа налево)
+        // Перемещаем наименьший элемент в начало; индекс беззнаковый, поэтому сравниваем first[i - 1] и first[i]
+        for (size_t i = end; i > start; --i) {
+            counter.compare();
+            if (comp(first[i], first[i - 1])) {
+                iter_swap(first + i - 1, first + i);
+                counter.move(3);
+                swapped = true;
+            }
+        }
+
+        // Перемещаем начальную точку на одну позицию вперед
+        // (наименьший элемент уже на своем месте)
+        ++start;
+    }
+}
+
+template <typename RandomIt, typename Compare = DefaultLess<RandomIt>>
+void shakerSort(RandomIt first, RandomIt last, Compare comp = Compare()) {
+    NoCounter none;
+    shakerSort(first, last, comp, none);
+}
+
+/**
+ * @brief Потоковое чтение целых чисел из текстового файла формата writeToFile()
+ * 
+ * Файл читается крупными блоками через fread, числа разбираются вручную,
+ * поэтому в памяти одновременно находится только один блок файла.
+ */
+class IntTextReader {
+public:
+    explicit IntTextReader(const string& filename, size_t bufferSize = 1 << 20)
+        : file(fopen(filename.c_str(), "rb")), buffer(bufferSize), pos(0), end(0), failed(false) {}
+
+    ~IntTextReader() {
+        if (file) {
+            fclose(file);
+        }
+    }
+
+    IntTextReader(const IntTextReader&) = delete;
+    IntTextReader& operator=(const IntTextReader&) = delete;
+
+    bool isOpen() const {
+        return file != nullptr;
+    }
+
+    // true если во входных данных встретилось что-то кроме целых чисел
+    bool hasError() const {
+        return failed;
+    }
+
+    /**
+     * @brief Читает следующее число
+     * 
+     * @return false в конце файла или при ошибке формата
+     */
+    bool next(int& value) {
+        int ch = skipSpaces();
+        if (ch == EOF) {
+            return false;
+        }
+
+        bool negative = false;
+        if (ch == '-') {
+            negative = true;
+            pos++;
+            ch = peek();
+        }
+        if (ch == EOF || !isdigit(ch)) {
+            failed = true;
+            return false;
+        }
+
+        // Накапливаем модуль в long long, чтобы обнаружить выход за пределы int
+        long long magnitude = 0;
+        while (ch != EOF && isdigit(ch)) {
+            magnitude = magnitude * 10 + (ch - '0');
+            if (magnitude > static_cast<long long>(numeric_limits<int>::max()) + 1) {
+                failed = true;
+                return false;
+            }
+            pos++;
+            ch = peek();
+        }
+        if (ch != EOF && !isspace(ch)) {
+            failed = true;
+            return false;
+        }
+
+        long long result = negative ? -magnitude : magnitude;
+        if (result > numeric_limits<int>::max()) {
+            failed = true;
+            return false;
+        }
+        value = static_cast<int>(result);
+        return true;
+    }
+
+private:
+    FILE* file;
+    vector<char> buffer;
+    size_t pos;   // Текущая позиция в буфере
+    size_t end;   // Количество прочитанных в буфер байт
+    bool failed;
+
+    // Возвращает текущий символ, подгружая следующий блок при необходимости
+    int peek() {
+        if (pos == end) {
+            end = fread(buffer.data(), 1, buffer.size(), file);
+            pos = 0;
+            if (end == 0) {
+                return EOF;
+            }
+        }
+        return static_cast<unsigned char>(buffer[pos]);
+    }
+
+    int skipSpaces() {
+        int ch = peek();
+        while (ch != EOF && isspace(ch)) {
+            pos++;
+            ch = peek();
+        }
+        return ch;
+    }
+};
+
+/**
+ * @brief Буферизованная запись целых чисел в текстовом формате writeToFile() ("число пробел")
+ */
+class IntTextWriter {
+public:
+    explicit IntTextWriter(const string& filename, size_t bufferSize = 1 << 20)
+        : file(fopen(filename.c_str(), "wb")), buffer(bufferSize), used(0), failed(file == nullptr) {}
+
+    ~IntTextWriter() {
+        close();
+    }
+
+    IntTextWriter(const IntTextWriter&) = delete;
+    IntTextWriter& operator=(const IntTextWriter&) = delete;
+
+    bool isOpen() const {
+        return file != nullptr;
+    }
+
+    void write(int value) {
+        // Самое длинное число int с минусом и пробелом занимает 12 символов
+        if (buffer.size() - used < 12) {
+            flush();
+        }
+        char* begin = buffer.data() + used;
+        char* last = to_chars(begin, buffer.data() + buffer.size(), value).ptr;
+        *last++ = ' ';
+        used = last - buffer.data();
+    }
+
+    /**
+     * @brief Дописывает буфер и закрывает файл
+     * 
+     * @return true если все данные успешно записаны
+     */
+    bool close() {
+        if (file) {
+            flush();
+            if (fclose(file) != 0) {
+                failed = true;
+            }
+            file = nullptr;
+        }
+        return !failed;
+    }
+
+private:
+    FILE* file;
+    vector<char> buffer;
+    size_t used;
+    bool failed;
+
+    void flush() {
+        if (used > 0 && fwrite(buffer.data(), 1, used, file) != used) {
+            failed = true;
+        }
+        used = 0;
+    }
+};
+
+// Формат файлов с числами
+enum class FileFormat {
+    Text,    // Числа через пробел (исходный формат writeToFile)
+    Binary   // Заголовок BINARY_FILE_MAGIC + количество (8 байт) + числа по 4 байта, little-endian
+};
+
+// Сигнатура двоичного файла с числами
+const char BINARY_FILE_MAGIC[8] = {'S', 'O', 'R', 'T', 'I', 'N', 'T', '1'};
+const size_t BINARY_HEADER_SIZE = sizeof(BINARY_FILE_MAGIC) + sizeof(uint64_t);
+
+// Расширение файла для формата
+string fileExtension(FileFormat format) {
+    return format == FileFormat::Binary ? ".bin" : ".txt";
+}
+
+// Порядок байт процессора совпадает с порядком байт двоичного формата
+bool isLittleEndianHost() {
+    const uint16_t probe = 1;
+    return *reinterpret_cast<const uint8_t*>(&probe) == 1;
+}
+
+/**
+ * @brief Файл, отображенный в память только для чтения
+ * 
+ * Данные читаются напрямую из страничного кэша, без копирования в буферы потоков.
+ * Там, где mmap недоступен, файл целиком читается в память.
+ */
+class MappedFile {
+public:
+    explicit MappedFile(const string& filename) : bytes(nullptr), length(0), mapped(false), opened(false) {
+#ifdef SORTING_HAS_MMAP
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return;
+        }
+        struct stat info;
+        if (fstat(fd, &info) == 0) {
+            opened = true;
+            length = static_cast<size_t>(info.st_size);
+            if (length > 0) {
+                void* address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (address == MAP_FAILED) {
+                    opened = false;
+                    length = 0;
+                } else {
+                    madvise(address, length, MADV_SEQUENTIAL);  // Подсказка ядру читать с опережением
+                    bytes = static_cast<const char*>(address);
+                    mapped = true;
+                }
+            }
+        }
+        close(fd);
+#else
+        ifstream file(filename, ios::binary);
+        if (!file) {
+            return;
+        }
+        fallback.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+        bytes = fallback.data();
+        length = fallback.size();
+        opened = true;
+#endif
+    }
+
+    ~MappedFile() {
+#ifdef SORTING_HAS_MMAP
+        if (mapped) {
+            munmap(const_cast<char*>(bytes), length);
+        }
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool isOpen() const {
+        return opened;
+    }
+
+    const char* data() const {
+        return bytes;
+    }
+
+    size_t size() const {
+        return length;
+    }
+
+private:
+    const char* bytes;
+    size_t length;
+    bool mapped;
+    bool opened;
+    vector<char> fallback;
+};
+
+/**
+ * @brief Разбирает числа из текста формата writeToFile() с помощью from_chars
+ * 
+ * @return true если текст целиком состоит из целых чисел, разделенных пробельными символами
+ */
+bool parseTextNumbers(const char* begin, const char* end, vector<int>& numbers) {
+    const char* p = begin;
+    while (true) {
+        while (p < end && isspace(static_cast<unsigned char>(*p))) {
+            p++;
+        }
+        if (p == end) {
+            return true;
+        }
+        int value;
+        auto result = from_chars(p, end, value);
+        if (result.ec != errc() || (result.ptr < end && !isspace(static_cast<unsigned char>(*result.ptr)))) {
+            return false;
+        }
+        numbers.push_back(value);
+        p = result.ptr;
+    }
+}
+
+/**
+ * @brief Читает массив целых чисел из файла, отображенного в память
+ * 
+ * Формат определяется по содержимому: файл с сигнатурой BINARY_FILE_MAGIC
+ * читается как двоичный, любой другой - как текстовый.
+ * 
+ * @param filename Имя входного файла
+ * @param numbers Массив, куда будут добавлены прочитанные числа
+ * @return true если чтение прошло успешно
+ */
+bool readFromFile(const string& filename, vector<int>& numbers) {
+    MappedFile file(filename);
+    if (!file.isOpen()) {
+        cerr << "Ошибка при открытии файла " << filename << endl;
+        return false;
+    }
+
+    const char* data = file.data();
+    size_t size = file.size();
+    if (size >= sizeof(BINARY_FILE_MAGIC) && equal(BINARY_FILE_MAGIC, BINARY_FILE_MAGIC + sizeof(BINARY_FILE_MAGIC), data)) {
+        uint64_t count = 0;
+        if (size >= BINARY_HEADER_SIZE) {
+            // Количество хранится в little-endian
+            for (int byte = 7; byte >= 0; byte--) {
+                count = (count << 8) | static_cast<uint8_t>(data[sizeof(BINARY_FILE_MAGIC) + byte]);
+            }
+        }
+        if (size < BINARY_HEADER_SIZE || (size - BINARY_HEADER_SIZE) / sizeof(int32_t) != count ||
+            (size - BINARY_HEADER_SIZE) % sizeof(int32_t) != 0) {
+            cerr << "Ошибка: поврежденный двоичный файл " << filename << endl;
+            return false;
+        }
+
+        size_t offset = numbers.size();
+        numbers.resize(offset + count);
+        memcpy(numbers.data() + offset, data + BINARY_HEADER_SIZE, count * sizeof(int32_t));
+        if (!isLittleEndianHost()) {
+            for (size_t i = offset; i < numbers.size(); i++) {
+                numbers[i] = static_cast<int>(__builtin_bswap32(static_cast<uint32_t>(numbers[i])));
+            }
+        }
+        return true;
+    }
+
+    if (!parseTextNumbers(data, data + size, numbers)) {
+        cerr << "Ошибка: файл " << filename << " содержит не только целые числа." << endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Записывает массив целых чисел в файл
+ * 
+ * Текстовый формат форматируется через to_chars в крупный буфер,
+ * двоичный записывается заголовком и одним блоком чисел.
+ * 
+ * @param arr Массив для записи
+ * @param filename Имя выходного файла
+ * @param format Формат файла
+ * @return true если запись прошла успешно, false в противном случае
+ */
+bool writeToFile(const vector<int>& arr, const string& filename, FileFormat format = FileFormat::Text) { // запись в файлы
+    if (format == FileFormat::Text) {
+        IntTextWriter writer(filename);
+        if (!writer.isOpen()) {
+            cerr << "Ошибка при открытии файла " << filename << endl;
+            return false;
+        }
+        for (int num : arr) {
+            writer.write(num);
+        }
+        return writer.close();
+    }
+
+    FILE* file = fopen(filename.c_str(), "wb");
+    if (!file) {
+        cerr << "Ошибка при открытии файла " << filename << endl;
+        return false;
+    }
+
+    char header[BINARY_HEADER_SIZE];
+    memcpy(header, BINARY_FILE_MAGIC, sizeof(BINARY_FILE_MAGIC));
+    uint64_t count = arr.size();
+    for (size_t byte = 0; byte < 8; byte++) {
+        header[sizeof(BINARY_FILE_MAGIC) + byte] = static_cast<char>((count >> (8 * byte)) & 0xFF);
+    }
+    bool ok = fwrite(header, 1, sizeof(header), file) == sizeof(header);
+
+    if (isLittleEndianHost()) {
+        ok = ok && fwrite(arr.data(), sizeof(int32_t), arr.size(), file) == arr.size();
+    } else {
+        vector<uint32_t> swapped(arr.size());
+        for (size_t i = 0; i < arr.size(); i++) {
+            swapped[i] = __builtin_bswap32(static_cast<uint32_t>(arr[i]));
+        }
+        ok = ok && fwrite(swapped.data(), sizeof(uint32_t), swapped.size(), file) == swapped.size();
+    }
+
+    ok = (fclose(file) == 0) && ok;
+    if (!ok) {
+        cerr << "Ошибка при записи файла " << filename << endl;
+    }
+    return ok;
+}
+
+/**
+ * @brief Временный файл-серия (run) внешней сортировки: отсортированные числа в двоичном виде
+ */
+struct RunFile {
+    string filename;
+    size_t count;   // Количество чисел в серии
+};
+
+/**
+ * @brief Записывает отсортированную серию в двоичный временный файл
+ * 
+ * @return true если запись прошла успешно
+ */
+bool writeRunFile(const int* data, size_t n, const string& filename) {
+    FILE* file = fopen(filename.c_str(), "wb");
+    if (!file) {
+        cerr << "Ошибка при открытии файла " << filename << endl;
+        return false;
+    }
+    bool ok = fwrite(data, sizeof(int), n, file) == n;
+    ok = (fclose(file) == 0) && ok;
+    if (!ok) {
+        cerr << "Ошибка при записи файла " << filename << endl;
+    }
+    return ok;
+}
+
+/**
+ * @brief Последовательное чтение серии с буферизацией блоками по bufferSize чисел
+ */
+class RunReader {
+public:
+    RunReader(const RunFile& run, size_t bufferSize)
+        : file(fopen(run.filename.c_str(), "rb")), buffer(bufferSize), pos(0), end(0), remaining(run.count) {
+        refill();
+    }
+
+    ~RunReader() {
+        if (file) {
+            fclose(file);
+        }
+    }
+
+    RunReader(const RunReader&) = delete;
+    RunReader& operator=(const RunReader&) = delete;
+
+    bool isOpen() const {
+        return file != nullptr;
+    }
+
+    // Серия закончилась
+    bool exhausted() const {
+        return pos == end;
+    }
+
+    // Текущее (наименьшее непрочитанное) число серии
+    int current() const {
+        return buffer[pos];
+    }
+
+    void advance() {
+        if (++pos == end) {
+            refill();
+        }
+    }
+
+private:
+    FILE* file;
+    vector<int> buffer;
+    size_t pos;
+    size_t end;
+    size_t remaining;  // Сколько чисел серии еще не загружено в буфер
+
+    void refill() {
+        pos = 0;
+        end = 0;
+        if (file && remaining > 0) {
+            end = fread(buffer.data(), sizeof(int), min(buffer.size(), remaining), file);
+            remaining -= end;
+        }
+    }
+};
+
+/**
+ * @brief Дерево проигравших для k-путевого слияния серий
+ * 
+ * Во внутренних узлах хранится индекс серии, проигравшей сравнение в этом узле,
+ * в tree[0] - победитель (серия с наименьшим текущим числом). После извлечения
+ * числа из серии-победителя достаточно переиграть один путь от ее листа к корню:
+ * log2(k) сравнений вместо k - 1 при линейном поиске минимума.
+ */
+class LoserTree {
+public:
+    explicit LoserTree(vector<unique_ptr<RunReader>>& readers) : runs(readers), tree(max<size_t>(readers.size(), 1)) {
+        tree[0] = build(1);
+    }
+
+    // Индекс серии с наименьшим текущим числом
+    size_t winner() const {
+        return tree[0];
+    }
+
+    // Все серии исчерпаны
+    bool empty() const {
+        return runs[tree[0]]->exhausted();
+    }
+
+    /**
+     * @brief Продвигает серию-победителя и переигрывает ее путь к корню
+     */
+    void pop() {
+        size_t candidate = tree[0];
+        runs[candidate]->advance();
+        for (size_t node = (candidate + runs.size()) / 2; node > 0; node /= 2) {
+            if (beats(tree[node], candidate)) {
+                swap(tree[node], candidate);
+            }
+        }
+        tree[0] = candidate;
+    }
+
+private:
+    vector<unique_ptr<RunReader>>& runs;
+    vector<size_t> tree;
+
+    // Серия a выигрывает у b: исчерпанные серии проигрывают всем,
+    // при равных числах выигрывает серия с меньшим индексом
+    bool beats(size_t a, size_t b) const {
+        if (runs[a]->exhausted() || runs[b]->exhausted()) {
+            return !runs[a]->exhausted() || (runs[b]->exhausted() && a < b);
+        }
+        if (runs[a]->current() != runs[b]->current()) {
+            return runs[a]->current() < runs[b]->current();
+        }
+        return a < b;
+    }
+
+    // Листья (серии) имеют номера узлов k..2k-1; возвращает победителя поддерева
+    size_t build(size_t node) {
+        size_t k = runs.size();
+        if (node >= k) {
+            return node - k;
+        }
+        size_t left = build(2 * node);
+        size_t right = build(2 * node + 1);
+        if (beats(left, right)) {
+            tree[node] = right;
+            return left;
+        }
+        tree[node] = left;
+        return right;
+    }
+};
+
+/**
+ * @brief Сливает серии в одну, передавая числа по возрастанию в emit
+ * 
+ * @param runs Серии для слияния
+ * @param bufferSize Размер буфера чтения каждой серии (в числах)
+ * @param emit Получатель очередного числа
+ * @return true если все серии удалось открыть
+ */
+template <typename Emit>
+bool mergeRunFiles(const vector<RunFile>& runs, size_t bufferSize, Emit emit) {
+    vector<unique_ptr<RunReader>> readers;
+    for (const auto& run : runs) {
+        readers.push_back(make_unique<RunReader>(run, bufferSize));
+        if (!readers.back()->isOpen()) {
+            cerr << "Ошибка при открытии файла " << run.filename << endl;
+            return false;
+        }
+    }
+
+    if (readers.empty()) {
+        return true;
+    }
+
+    LoserTree tree(readers);
+    while (!tree.empty()) {
+        emit(readers[tree.winner()]->current());
+        tree.pop();
+    }
     return true;
 }
 
+// Минимальный размер буфера чтения одной серии при слиянии (в байтах)
+const size_t MIN_RUN_BUFFER_BYTES = 64 * 1024;
+
+// Файлы, открытые помимо серий при слиянии: stdin/stdout/stderr, входной и выходной файлы и запас
+const size_t RESERVED_FILE_DESCRIPTORS = 8;
+
 /**
- * @brief Объединяет два отсортированных подмассива в один отсортированный массив
+ * @brief Сколько серий можно сливать за раз: каждой нужен буфер не меньше MIN_RUN_BUFFER_BYTES
+ *        и открытый файл, поэтому число ограничено и памятью, и лимитом открытых файлов процесса
+ */
+size_t maxMergeFanIn(size_t memoryBytes) {
+    size_t fanIn = max<size_t>(memoryBytes / MIN_RUN_BUFFER_BYTES, 3) - 1;
+#ifdef SORTING_HAS_SYSCONF
+    long openMax = sysconf(_SC_OPEN_MAX);  // -1 - лимита нет
+    if (openMax > 0) {
+        fanIn = min(fanIn, max<size_t>((size_t)openMax, RESERVED_FILE_DESCRIPTORS + 2) - RESERVED_FILE_DESCRIPTORS);
+    }
+#endif
+    return fanIn;
+}
+
+/**
+ * @brief Внешняя сортировка слиянием текстового файла, не помещающегося в память
  * 
- * Это часть алгоритма прямой сортировки слиянием. Функция принимает два соседних отсортированных
- * подмассива и объединяет их в один отсортированный массив.
+ * 1. Файл читается порциями по memoryBytes (половина порции - буфер слияния),
+ *    каждая порция сортируется в памяти и сохраняется во временный двоичный файл-серию
+ * 2. Если серий больше, чем можно слить за раз (см. maxMergeFanIn()),
+ *    они сливаются группами в более длинные серии
+ * 3. Оставшиеся серии сливаются деревом проигравших в выходной текстовый файл
  * 
- * @param arr Массив, содержащий оба подмассива для слияния
- * @param left Начальный индекс первого подмассива
- * @param mid Конечный индекс первого подмассива
- * @param right Конечный индекс второго подмассива
+ * @param inputFileName Входной файл в формате writeToFile() (например, original_data_*.txt)
+ * @param outputFileName Имя выходного файла
+ * @param tempPrefix Префикс имен временных файлов-серий
+ * @param memoryBytes Ограничение памяти под данные
+ * @param threads Число потоков для сортировки порций
+ * @return true если сортировка прошла успешно
  */
-void merge(vector<int>& arr, int left, int mid, int right) { // прямое слияние функция слияния
-                                                            //функция объединяет два отсортированных подмассива в один отсортированный массив
-    // Вычисляем размеры двух подмассивов для слияния
-    int n1 = mid - left + 1;
-    int n2 = right - mid;
+bool externalMergeSort(const string& inputFileName, const string& outputFileName, const string& tempPrefix,
+                       size_t memoryBytes, size_t threads) {
+    IntTextReader reader(inputFileName);
+    if (!reader.isOpen()) {
+        cerr << "Ошибка при открытии файла " << inputFileName << endl;
+        return false;
+    }
 
-    // Создаем временные массивы для хранения подмассивов
-    vector<int> L(n1), R(n2);
+    vector<RunFile> runs;
+    size_t tempCounter = 0;
+    auto nextTempName = [&] { return tempPrefix + to_string(tempCounter++) + ".bin"; };
+    auto removeRuns = [](const vector<RunFile>& list) {
+        for (const auto& run : list) {
+            remove(run.filename.c_str());
+        }
+    };
 
-    // Копируем данные во временные массивы L[] и R[]
-    for (int i = 0; i < n1; i++)
-        L[i] = arr[left + i];
-    for (int j = 0; j < n2; j++)
-        R[j] = arr[mid + 1 + j];
+    // Этап 1: формирование отсортированных серий
+    {
+        size_t chunkSize = max<size_t>(memoryBytes / (2 * sizeof(int)), 1);
+        vector<int> chunk;
+        vector<int> buffer;
+        chunk.reserve(chunkSize);
 
+        bool done = false;
+        while (!done) {
+            chunk.clear();
+            int value;
+            while (chunk.size() < chunkSize && reader.next(value)) {
+                chunk.push_back(value);
+            }
+            done = chunk.size() < chunkSize;
+            if (reader.hasError()) {
+                cerr << "Ошибка: файл " << inputFileName << " содержит не только целые числа." << endl;
+                removeRuns(runs);
+                return false;
+            }
+            if (chunk.empty()) {
+                break;
+            }
 
-    int i = 0;    // Начальный индекс первого подмассива
-    int j = 0;    // Начальный индекс второго подмассива
-    int k = left; // Начальный индекс объединенного подмассива
+            if (threads > 1) {
+                parallelMergeSort(chunk.begin(), chunk.end(), threads);
+            } else {
+                buffer.resize(chunk.size());
+                mergeSortWithBuffer(chunk.data(), buffer.data(), chunk.size());
+            }
 
-    // Сравниваем элементы из обоих массивов и помещаем меньший в исходный массив
-    while (i < n1 && j < n2) {
-        if (L[i] <= R[j]) {
-            arr[k] = L[i];
-            i++;
-        } else {
-            arr[k] = R[j];
-            j++;
+            RunFile run{nextTempName(), chunk.size()};
+            if (!writeRunFile(chunk.data(), chunk.size(), run.filename)) {
+                removeRuns(runs);
+                return false;
+            }
+            runs.push_back(run);
         }
-        k++;
     }
 
-    // Копируем оставшиеся элементы L[], если они есть
-    while (i < n1) {
-        arr[k] = L[i];
-        i++;
-        k++;
+    // Этап 2: промежуточные слияния, пока серий больше допустимого числа
+    size_t maxFanIn = maxMergeFanIn(memoryBytes);
+    while (runs.size() > maxFanIn) {
+        vector<RunFile> merged;
+        for (size_t first = 0; first < runs.size(); first += maxFanIn) {
+            vector<RunFile> group(runs.begin() + first, runs.begin() + min(first + maxFanIn, runs.size()));
+            RunFile output{nextTempName(), 0};
+            for (const auto& run : group) {
+                output.count += run.count;
+            }
+
+            // Память делится поровну между буферами входных серий и выходным буфером
+            size_t bufferSize = max<size_t>(memoryBytes / sizeof(int) / (group.size() + 1), 1);
+            vector<int> outBuffer;
+            outBuffer.reserve(bufferSize);
+            FILE* outFile = fopen(output.filename.c_str(), "wb");
+            bool ok = outFile != nullptr;
+            auto flushOut = [&] {
+                if (ok && fwrite(outBuffer.data(), sizeof(int), outBuffer.size(), outFile) != outBuffer.size()) {
+                    ok = false;
+                }
+                outBuffer.clear();
+            };
+            ok = ok && mergeRunFiles(group, bufferSize, [&](int value) {
+                outBuffer.push_back(value);
+                if (outBuffer.size() == bufferSize) {
+                    flushOut();
+                }
+            });
+            flushOut();
+            if (outFile && fclose(outFile) != 0) {
+                ok = false;
+            }
+            removeRuns(group);
+            if (!ok) {
+                cerr << "Ошибка при записи файла " << output.filename << endl;
+                remove(output.filename.c_str());
+                removeRuns(merged);
+                removeRuns(vector<RunFile>(runs.begin() + min(first + maxFanIn, runs.size()), runs.end()));
+                return false;
+            }
+            merged.push_back(output);
+        }
+        runs = merged;
     }
 
-    // Копируем оставшиеся элементы R[], если они есть
-    while (j < n2) {
-        arr[k] = R[j];
-        j++;
-        k++;
+    // Этап 3: итоговое слияние в текстовый файл
+    IntTextWriter writer(outputFileName, max<size_t>(memoryBytes / (runs.size() + 1), 1 << 16));
+    if (!writer.isOpen()) {
+        cerr << "Ошибка при открытии файла " << outputFileName << endl;
+        removeRuns(runs);
+        return false;
+    }
+    size_t bufferSize = max<size_t>(memoryBytes / sizeof(int) / (runs.size() + 1), 1);
+    bool ok = mergeRunFiles(runs, bufferSize, [&](int value) { writer.write(value); });
+    removeRuns(runs);
+    if (!writer.close()) {
+        cerr << "Ошибка при записи файла " << outputFileName << endl;
+        return false;
     }
+    return ok;
 }
 
+// Параметры командной строки
+struct Options {
+    size_t threads = 1;           // Число потоков для сортировки слиянием
+    string externalInput;         // Входной файл для внешней сортировки (пусто - интерактивный режим)
+    size_t memoryMegabytes = 256; // Ограничение памяти для внешней сортировки
+    string algorithms;            // Алгоритмы через запятую (пусто - все)
+    bool simd = true;             // Использовать векторные примитивы сортировки слиянием
+    string inputFile;             // Файл с исходными числами (пусто - ввод с клавиатуры или генерация)
+    FileFormat format = FileFormat::Text;  // Формат выходных файлов
+
+    // Режим бенчмарка
+    bool benchmark = false;       // Запустить бенчмарк вместо интерактивного режима
+    size_t benchSize = 1000000;   // Размер массива
+    string distribution = "uniform";  // Распределение данных
+    size_t swaps = 0;             // Число случайных обменов для nearly-sorted (0 - 1% от размера)
+    size_t repetitions = 5;       // Число замеров каждого алгоритма
+    size_t seed = 42;             // Зерно генератора данных
+    bool seedGiven = false;       // Зерно задано через --seed (иначе генерация в интерактивном режиме случайна)
+    string keyType = "int";       // Тип ключей: int, int64 или double
+
+    // Генерация исходных данных по зерну без интерактивного ввода
+    size_t generateCount = 0;     // Сколько чисел сгенерировать (0 - не генерировать)
+    int generateMin = numeric_limits<int>::min();  // Диапазон генерируемых чисел
+    int generateMax = numeric_limits<int>::max();
+};
+
 /**
- * @brief Реализует алгоритм прямой сортировки слиянием рекурсивно
+ * @brief Разбирает неотрицательное целое число из аргумента командной строки
  * 
- * Это классическая реализация сортировки слиянием (прямое слияние), которая следует
- * подходу "разделяй и властвуй":
- * 1. Делит массив на две равные половины
- * 2. Рекурсивно сортирует две половины
- * 3. Объединяет отсортированные половины
+ * @return true если строка целиком является числом, помещающимся в size_t
+ */
+bool parseSize(const char* text, size_t& value) {
+    if (*text == '\0') {
+        return false;
+    }
+    size_t result = 0;
+    for (const char* p = text; *p; p++) {
+        if (!isdigit(static_cast<unsigned char>(*p))) {
+            return false;
+        }
+        size_t digit = *p - '0';
+        if (result > (SIZE_MAX - digit) / 10) {
+            return false;  // Переполнение: иначе слишком большое зерно молча стало бы другим числом
+        }
+        result = result * 10 + digit;
+    }
+    value = result;
+    return true;
+}
+
+/**
+ * @brief Разбирает диапазон чисел вида "MIN:MAX" (например, "-100:100")
  * 
- * В отличие от естественной сортировки слиянием, которая находит и объединяет уже отсортированные
- * последовательности, прямая сортировка слиянием искусственно делит массив независимо от существующего порядка.
+ * @return true если обе границы - целые числа и MIN <= MAX
+ */
+bool parseRange(const char* text, int& minValue, int& maxValue) {
+    const char* end = text + strlen(text);
+    const char* colon = find(text + (*text == '-' ? 1 : 0), end, ':');
+    if (colon == end) {
+        return false;
+    }
+    int low, high;
+    auto first = from_chars(text, colon, low);
+    auto second = from_chars(colon + 1, end, high);
+    if (first.ec != errc() || first.ptr != colon || second.ec != errc() || second.ptr != end || low > high) {
+        return false;
+    }
+    minValue = low;
+    maxValue = high;
+    return true;
+}
+
+const size_t MAX_THREADS = 1024;  // Больше потоков не ускоряет, а запуск каждого стоит памяти под стек
+
+// Выводит справку по аргументам командной строки
+void printUsage(const char* program) {
+    cerr << "Использование: " << program << " [--algo СПИСОК] [--threads N] [--no-simd] [--input ФАЙЛ] [--format txt|bin]" << endl;
+    cerr << "       " << program << " --generate N [--range MIN:MAX] [--seed S] [--threads N] [--algo СПИСОК] [--format txt|bin]" << endl;
+    cerr << "       " << program << " --external ФАЙЛ [--memory МБ] [--threads N]" << endl;
+    cerr << "       " << program << " --bench [--algo СПИСОК] [--size N] [--dist РАСПРЕДЕЛЕНИЕ] [--swaps K]"
+         << " [--reps R] [--seed S] [--type ТИП] [--threads N] [--no-simd]" << endl;
+    cerr << "  --algo СПИСОК      алгоритмы через запятую: merge, shaker, natural, radix (по умолчанию все)" << endl;
+    cerr << "  --threads N        число потоков для сортировки слиянием (1.." << MAX_THREADS << ", по умолчанию 1)" << endl;
+    cerr << "  --no-simd          не использовать векторные (SSE4.1/AVX2) примитивы слияния" << endl;
+    cerr << "  --input ФАЙЛ       взять исходные числа из файла (.txt или .bin) вместо ввода" << endl;
+    cerr << "  --format txt|bin   формат выходных файлов: текстовый или двоичный (по умолчанию txt)" << endl;
+    cerr << "  --generate N       сгенерировать N случайных чисел вместо ввода (в --threads потоках," << endl;
+    cerr << "                     при одном зерне результат не зависит от числа потоков)" << endl;
+    cerr << "  --range MIN:MAX    диапазон генерируемых чисел (по умолчанию весь диапазон int)" << endl;
+    cerr << "  --external ФАЙЛ    внешняя сортировка файла в формате original_data_*.txt" << endl;
+    cerr << "  --memory МБ        ограничение памяти для внешней сортировки (по умолчанию 256)" << endl;
+    cerr << "  --bench            замерить время сортировки и вывести результат в формате JSON" << endl;
+    cerr << "                     (без --algo замеряются merge, natural и radix)" << endl;
+    cerr << "  --size N           размер массива для бенчмарка (по умолчанию 1000000)" << endl;
+    cerr << "  --dist ИМЯ         uniform, sorted, reversed, few-unique, organ-pipe, nearly-sorted" << endl;
+    cerr << "  --swaps K          число случайных обменов для nearly-sorted (по умолчанию 1% от размера)" << endl;
+    cerr << "  --reps R           число замеров каждого алгоритма (по умолчанию 5)" << endl;
+    cerr << "  --seed S           зерно генератора данных (в бенчмарке по умолчанию 42)" << endl;
+    cerr << "  --type ТИП         тип ключей бенчмарка: int, int64 или double (по умолчанию int)" << endl;
+}
+
+/**
+ * @brief Разбирает аргументы командной строки (см. printUsage())
  * 
- * @param arr Массив для сортировки
- * @param left Начальный индекс массива или подмассива
- * @param right Конечный индекс массива или подмассива
+ * @return true если аргументы корректны
  */
-void mergeSort(vector<int>& arr, int left, int right) { 
-    if (left < right) {
-        // Находим среднюю точку для разделения массива на две половины
-        int mid = left + (right - left) / 2;
+bool parseArguments(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
 
-        // Сортируем первую и вторую половины
-        mergeSort(arr, left, mid);
-        mergeSort(arr, mid + 1, right);
+        if (arg == "--threads") {
+            if (!hasValue || !parseSize(argv[i + 1], options.threads) || options.threads == 0 ||
+                options.threads > MAX_THREADS) {
+                cerr << "Ошибка: после --threads ожидается число потоков (1.." << MAX_THREADS << ")." << endl;
+                return false;
+            }
+            i++;
+        } else if (arg == "--algo") {
+            if (!hasValue) {
+                cerr << "Ошибка: после --algo ожидается список алгоритмов." << endl;
+                return false;
+            }
+            options.algorithms = argv[++i];
+        } else if (arg == "--no-simd") {
+            options.simd = false;
+        } else if (arg == "--input") {
+            if (!hasValue) {
+                cerr << "Ошибка: после --input ожидается имя файла." << endl;
+                return false;
+            }
+            options.inputFile = argv[++i];
+        } else if (arg == "--generate") {
+            if (!hasValue || !parseSize(argv[i + 1], options.generateCount) || options.generateCount == 0) {
+                cerr << "Ошибка: после --generate ожидается положительное количество чисел." << endl;
+                return false;
+            }
+            i++;
+        } else if (arg == "--range") {
+            if (!hasValue || !parseRange(argv[i + 1], options.generateMin, options.generateMax)) {
+                cerr << "Ошибка: после --range ожидается диапазон MIN:MAX, где MIN <= MAX." << endl;
+                return false;
+            }
+            i++;
+        } else if (arg == "--format") {
+            string format = hasValue ? argv[i + 1] : "";
+            if (format == "txt") {
+                options.format = FileFormat::Text;
+            } else if (format == "bin") {
+                options.format = FileFormat::Binary;
+            } else {
+                cerr << "Ошибка: после --format ожидается txt или bin." << endl;
+                return false;
+            }
+            i++;
+        } else if (arg == "--bench") {
+            options.benchmark = true;
+        } else if (arg == "--dist") {
+            if (!hasValue) {
+                cerr << "Ошибка: после --dist ожидается имя распределения." << endl;
+                return false;
+            }
+            options.distribution = argv[++i];
+        } else if (arg == "--type") {
+            if (!hasValue) {
+                cerr << "Ошибка: после --type ожидается тип ключей." << endl;
+                return false;
+            }
+            options.keyType = argv[++i];
+            if (options.keyType != "int" && options.keyType != "int64" && options.keyType != "double") {
+                cerr << "Ошибка: неизвестный тип ключей " << options.keyType << " (доступны int, int64, double)." << endl;
+                return false;
+            }
+        } else if (arg == "--size" || arg == "--swaps" || arg == "--reps" || arg == "--seed") {
+            size_t& target = arg == "--size" ? options.benchSize
+                           : arg == "--swaps" ? options.swaps
+                           : arg == "--reps" ? options.repetitions
+                           : options.seed;
+            if (!hasValue || !parseSize(argv[i + 1], target)) {
+                cerr << "Ошибка: после " << arg << " ожидается неотрицательное число." << endl;
+                return false;
+            }
+            options.seedGiven = options.seedGiven || arg == "--seed";
+            i++;
+        } else if (arg == "--external") {
+            if (!hasValue) {
+                cerr << "Ошибка: после --external ожидается имя файла." << endl;
+                return false;
+            }
+            options.externalInput = argv[++i];
+        } else if (arg == "--memory") {
+            if (!hasValue || !parseSize(argv[i + 1], options.memoryMegabytes) || options.memoryMegabytes == 0) {
+                cerr << "Ошибка: после --memory ожидается положительный объем памяти в МБ." << endl;
+                return false;
+            }
+            i++;
+        } else {
+            cerr << "Неизвестный аргумент: " << arg << endl;
+            printUsage(argv[0]);
+            return false;
+        }
+    }
+    if (!options.externalInput.empty() && options.format == FileFormat::Binary) {
+        cerr << "Ошибка: внешняя сортировка работает только с текстовыми файлами (--format bin не поддерживается)." << endl;
+        return false;
+    }
+    return true;
+}
 
-        // Объединяем отсортированные половины
-        merge(arr, left, mid, right);
+// Алгоритм сортировки, доступный для выбора через --algo
+template <typename T>
+struct SortAlgorithm {
+    string name;                         // Имя для --algo
+    string filePrefix;                   // Префикс файла с результатом
+    string description;                  // "отсортированный <description>"
+    function<void(vector<T>&)> sort;     // Сама сортировка
+    // Та же сортировка с подсчетом сравнений и присваиваний (скалярная, в одном потоке)
+    function<void(vector<T>&, OperationCounter&)> countOperations;
+};
+
+/**
+ * @brief Возвращает список всех алгоритмов сортировки ключей типа T с учетом параметров
+ * 
+ * Поразрядная сортировка есть только для целых типов.
+ */
+template <typename T>
+vector<SortAlgorithm<T>> availableAlgorithms(const Options& options) {
+    size_t threads = options.threads;
+    less<T> comp;
+    vector<SortAlgorithm<T>> algorithms = {
+        {"merge", "sorted_by_straight_merge_", "методом прямого слияния",
+         [threads](vector<T>& arr) {
+             if (threads > 1) {
+                 parallelMergeSort(arr.begin(), arr.end(), threads);
+             } else {
+                 mergeSortBottomUp(arr.begin(), arr.end());
+             }
+         },
+         [comp](vector<T>& arr, OperationCounter& counter) { mergeSortBottomUp(arr.begin(), arr.end(), comp, counter); }},
+        {"shaker", "sorted_by_shaker_", "шейкерным методом",
+         [](vector<T>& arr) { shakerSort(arr.begin(), arr.end()); },
+         [comp](vector<T>& arr, OperationCounter& counter) { shakerSort(arr.begin(), arr.end(), comp, counter); }},
+        {"natural", "sorted_by_natural_merge_", "методом естественного слияния",
+         [](vector<T>& arr) { naturalMergeSort(arr.begin(), arr.end()); },
+         [comp](vector<T>& arr, OperationCounter& counter) { naturalMergeSort(arr.begin(), arr.end(), comp, counter); }},
+    };
+    if constexpr (IS_RADIX_SORTABLE<T>) {
+        algorithms.push_back(
+            {"radix", "sorted_by_radix_", "поразрядным методом",
+             [](vector<T>& arr) { radixSort(arr.begin(), arr.end()); },
+             [](vector<T>& arr, OperationCounter& counter) { radixSort(arr.begin(), arr.end(), counter); }});
     }
+    return algorithms;
 }
 
 /**
- * @brief Реализует алгоритм шейкерной (коктейльной) сортировки
+ * @brief Оставляет из algorithms только перечисленные через запятую в names
  * 
- * Шейкерная сортировка - это вариация пузырьковой сортировки, которая сортирует в обоих направлениях.
- * Она работает путем:
- * 1. Перемещения наибольших элементов в конец (проход справа налево)
- * 2. Затем перемещения наименьших элементов в начало (проход слева направо)
- * 3. Повторения этих действий, пока массив не будет отсортирован
+ * @return false если среди names есть неизвестное имя
+ */
+template <typename T>
+bool selectAlgorithms(const string& names, vector<SortAlgorithm<T>>& algorithms) {
+    vector<SortAlgorithm<T>> selected;
+    size_t start = 0;
+    while (start <= names.size()) {
+        size_t comma = names.find(',', start);
+        if (comma == string::npos) {
+            comma = names.size();
+        }
+        string name = names.substr(start, comma - start);
+        auto found = find_if(algorithms.begin(), algorithms.end(),
+                             [&](const SortAlgorithm<T>& a) { return a.name == name; });
+        if (found == algorithms.end()) {
+            cerr << "Неизвестный алгоритм: " << name << endl;
+            return false;
+        }
+        selected.push_back(*found);
+        start = comma + 1;
+    }
+    algorithms = selected;
+    return true;
+}
+
+/**
+ * @brief Составляет список алгоритмов по --algo
  * 
- * Этот двунаправленный подход может быть более эффективным, чем стандартная пузырьковая сортировка
- * для определенных распределений данных.
+ * Шейкерная сортировка квадратичная, поэтому в бенчмарке без --algo она не замеряется.
  * 
- * @param arr Массив для сортировки
+ * @return false если в --algo есть неизвестное имя
  */
-void shakerSort(vector<int>& arr) {
-    bool swapped = true;
-    int start = 0;
-    int end = arr.size() - 1;
-
-    while (swapped) {
-        // Сбрасываем флаг обмена для первого прохода
-        swapped = false;
+template <typename T>
+bool chooseAlgorithms(const Options& options, vector<SortAlgorithm<T>>& algorithms) {
+    algorithms = availableAlgorithms<T>(options);
+    string selection = options.algorithms;
+    if (selection.empty() && options.benchmark) {
+        selection = IS_RADIX_SORTABLE<T> ? "merge,natural,radix" : "merge,natural";
+    }
+    return selection.empty() || selectAlgorithms(selection, algorithms);
+}
 
-        // Прямой проход (слева направо) - как при пузырьковой сортировке
-        // Перемещаем наибольший элемент в конец
-        for (int i = start; i < end; ++i) {
-            if (arr[i] > arr[i + 1]) {
-                swap(arr[i], arr[i + 1]);
-                swapped = true;
-            }
-        }
+// Число потоков для генерации данных: результат от него не зависит, поэтому заняты все ядра
+size_t generationThreads(const Options& options) {
+    return max<size_t>(options.threads, thread::hardware_concurrency());
+}
 
-        // Если ничего не переместилось, массив отсортирован
-        if (!swapped)
-            break;
+// Распределения исходных данных для бенчмарка
+const char* const BENCHMARK_DISTRIBUTIONS[] = {
+    "uniform", "sorted", "reversed", "few-unique", "organ-pipe", "nearly-sorted"};
 
-        // Сбрасываем флаг обмена для обратного прохода
-        swapped = false;
-        
-        // Перемещаем конечную точку на одну позицию назад
-        // (наибольший элемент уже на своем месте)
-        --end;
+/**
+ * @brief Генерирует массив для бенчмарка с заданным распределением
+ * 
+ * uniform       - равномерно по всему диапазону типа T (для double - по [-1e9, 1e9))
+ * sorted        - те же числа, отсортированные по возрастанию
+ * reversed      - отсортированные по убыванию
+ * few-unique    - всего 16 различных значений
+ * organ-pipe    - возрастание до середины, затем убывание (0 1 2 ... 2 1 0)
+ * nearly-sorted - отсортированный массив, в котором swaps раз переставлены случайные пары
+ * 
+ * Случайные значения генерируются счетным генератором (seeded_random.h) в threadCount потоках;
+ * массив зависит только от seed, но не от числа потоков.
+ * 
+ * @return false если распределение неизвестно
+ */
+template <typename T>
+bool generateDistribution(const string& distribution, size_t n, size_t swaps, uint64_t seed,
+                          size_t threadCount, vector<T>& numbers) {
+    auto anyValue = [seed](size_t i) -> T {
+        if constexpr (is_integral<T>::value) {
+            return seededRandomValue(seed, i, numeric_limits<T>::min(), numeric_limits<T>::max());
+        } else {
+            return static_cast<T>(seededRandomUnit(seed, i) * 2e9 - 1e9);
+        }
+    };
+    numbers.resize(n);
 
-        // Обратный проход (справа налево)
-        // Перемещаем наименьший элемент в начало
-        for (int i = end - 1; i >= start; --i) {
-            if (arr[i] > arr[i + 1]) {
-                swap(arr[i], arr[i + 1]);
-                swapped = true;
+    if (distribution == "uniform" || distribution == "sorted" || distribution == "reversed" ||
+        distribution == "nearly-sorted") {
+        fillParallel(numbers.data(), n, threadCount, anyValue);
+        if (distribution == "sorted" || distribution == "nearly-sorted") {
+            sort(numbers.begin(), numbers.end());
+        } else if (distribution == "reversed") {
+            sort(numbers.begin(), numbers.end(), greater<T>());
+        }
+        if (distribution == "nearly-sorted" && n > 1) {
+            // Номера пар берутся из того же потока после номеров значений
+            for (size_t k = 0; k < swaps; k++) {
+                swap(numbers[seededRandomValue<size_t>(seed, n + 2 * k, 0, n - 1)],
+                     numbers[seededRandomValue<size_t>(seed, n + 2 * k + 1, 0, n - 1)]);
             }
         }
-
-        // Перемещаем начальную точку на одну позицию вперед
-        // (наименьший элемент уже на своем месте)
-        ++start;
+    } else if (distribution == "few-unique") {
+        fillParallel(numbers.data(), n, threadCount,
+                     [seed](size_t i) { return static_cast<T>(seededRandomValue(seed, i, 0, 15)); });
+    } else if (distribution == "organ-pipe") {
+        for (size_t i = 0; i < n; i++) {
+            numbers[i] = static_cast<T>(min(i, n - 1 - i));
+        }
+    } else {
+        return false;
     }
+    return true;
+}
+
+// Значение перцентиля p (0..100) по отсортированным замерам, метод ближайшего ранга
+double percentile(const vector<double>& sortedSamples, double p) {
+    size_t rank = static_cast<size_t>(p / 100.0 * sortedSamples.size() + 0.999999);
+    rank = min(max<size_t>(rank, 1), sortedSamples.size());
+    return sortedSamples[rank - 1];
 }
 
 /**
- * @brief Записывает массив целых чисел в файл
+ * @brief Неинтерактивный бенчмарк: замеряет выбранные алгоритмы и выводит JSON в stdout
  * 
- * @param arr Массив для записи
- * @param filename Имя выходного файла
- * @return true если запись прошла успешно, false в противном случае
+ * Каждый алгоритм сортирует копию одних и тех же данных options.repetitions раз.
+ * Результат каждого замера сверяется с эталоном (std::sort). Сравнения и присваивания
+ * считаются в отдельном, не замеряемом запуске скалярной однопоточной версии алгоритма.
+ * 
+ * @return Код завершения программы
  */
-bool writeToFile(const vector<int>& arr, const string& filename) { // запись в файлы
-    ofstream outFile(filename);
-    if (!outFile) {
-        cerr << "Ошибка при открытии файла " << filename << endl;
-        return false;
+template <typename T>
+int runBenchmark(const Options& options) {
+    vector<SortAlgorithm<T>> algorithms;
+    if (!chooseAlgorithms(options, algorithms)) {
+        return 1;
+    }
+
+    vector<T> data;
+    size_t swaps = options.swaps > 0 ? options.swaps : options.benchSize / 100;
+    if (!generateDistribution(options.distribution, options.benchSize, swaps, options.seed,
+                              generationThreads(options), data)) {
+        cerr << "Неизвестное распределение: " << options.distribution << ". Доступны:";
+        for (const char* name : BENCHMARK_DISTRIBUTIONS) {
+            cerr << " " << name;
+        }
+        cerr << endl;
+        return 1;
+    }
+    if (options.repetitions == 0) {
+        cerr << "Ошибка: число замеров должно быть положительным." << endl;
+        return 1;
     }
 
-    for (const auto& num : arr) {
-        outFile << num << " ";
+    vector<T> expected = data;
+    sort(expected.begin(), expected.end());
+
+    cout << "{" << endl;
+    cout << "  \"benchmark\": \"sorting\"," << endl;
+    cout << "  \"size\": " << options.benchSize << "," << endl;
+    cout << "  \"distribution\": \"" << options.distribution << "\"," << endl;
+    cout << "  \"key_type\": \"" << options.keyType << "\"," << endl;
+    if (options.distribution == "nearly-sorted") {
+        cout << "  \"swaps\": " << swaps << "," << endl;
     }
-    outFile.close();
-    return true;
+    cout << "  \"repetitions\": " << options.repetitions << "," << endl;
+    cout << "  \"seed\": " << options.seed << "," << endl;
+    cout << "  \"threads\": " << options.threads << "," << endl;
+    cout << "  \"kernels\": \"" << activeSortKernels().name << "\"," << endl;
+    cout << "  \"results\": [" << endl;
+
+    bool allCorrect = true;
+    for (size_t a = 0; a < algorithms.size(); a++) {
+        const SortAlgorithm<T>& algorithm = algorithms[a];
+        vector<double> seconds;
+        bool correct = true;
+
+        for (size_t rep = 0; rep < options.repetitions; rep++) {
+            vector<T> work = data;
+            auto start = chrono::steady_clock::now();
+            algorithm.sort(work);
+            auto finish = chrono::steady_clock::now();
+            seconds.push_back(chrono::duration<double>(finish - start).count());
+            correct = correct && work == expected;
+        }
+        allCorrect = allCorrect && correct;
+
+        OperationCounter counter;
+        {
+            vector<T> work = data;
+            algorithm.countOperations(work, counter);
+        }
+
+        double mean = 0;
+        for (double t : seconds) {
+            mean += t;
+        }
+        mean /= seconds.size();
+        sort(seconds.begin(), seconds.end());
+
+        cout << fixed << setprecision(6);
+        cout << "    {" << endl;
+        cout << "      \"algorithm\": \"" << algorithm.name << "\"," << endl;
+        cout << "      \"correct\": " << (correct ? "true" : "false") << "," << endl;
+        cout << "      \"mean_seconds\": " << mean << "," << endl;
+        cout << "      \"min_seconds\": " << seconds.front() << "," << endl;
+        cout << "      \"p50_seconds\": " << percentile(seconds, 50) << "," << endl;
+        cout << "      \"p90_seconds\": " << percentile(seconds, 90) << "," << endl;
+        cout << "      \"p99_seconds\": " << percentile(seconds, 99) << "," << endl;
+        cout << "      \"max_seconds\": " << seconds.back() << "," << endl;
+        cout << setprecision(0);
+        cout << "      \"elements_per_second\": " << (mean > 0 ? options.benchSize / mean : 0.0) << "," << endl;
+        cout << "      \"comparisons\": " << counter.comparisons << "," << endl;
+        cout << "      \"moves\": " << counter.moves << endl;
+        cout << "    }" << (a + 1 < algorithms.size() ? "," : "") << endl;
+    }
+
+    cout << "  ]" << endl;
+    cout << "}" << endl;
+    return allCorrect ? 0 : 1;
 }
 
 /**
- * @brief Основная функция программы
+ * @brief Заполняет список чисел вручную или случайной генерацией по выбору пользователя
  * 
- * Обрабатывает пользовательский ввод, генерацию массива, сортировку и вывод в файл.
+ * @param numbers Массив, куда будут добавлены числа
+ * @param options Параметры: зерно (--seed) и число потоков для генерации
+ * @return false если генерация случайных чисел завершилась ошибкой
  */
-int main() {
-    vector<int> numbers;
+bool fillNumbersInteractively(vector<int>& numbers, const Options& options) {
     char choice;
-    
-    // Настраиваем вывод на русском языке
-    setlocale(LC_ALL, "Russian");
-    
-    // Создаем имена файлов с временной меткой для уникальности
-    time_t now = time(0);
-    string timestamp = to_string(now);
-    string initialFileName = "original_data_" + timestamp + ".txt";
-    string mergeSortFileName = "sorted_by_straight_merge_" + timestamp + ".txt";
-    string shakerSortFileName = "sorted_by_shaker_" + timestamp + ".txt";
-
     bool validChoice = false;
     while (!validChoice) {
         cout << "Как вы хотите заполнить список чисел?" << endl;
@@ -294,67 +2792,126 @@ int main() {
         }
 
         try {
-            // Генерируем случайные числа с использованием генератора Mersenne Twister
-            random_device rd;  // Используется для получения семени для генератора случайных чисел
-            mt19937 gen(rd()); // Стандартный генератор mersenne_twister_engine
-            uniform_int_distribution<> distrib(min_value, max_value);
-
-            for (int i = 0; i < count; i++) {
-                numbers.push_back(distrib(gen));
+            // Без --seed зерно берется из random_device и выводится, чтобы набор можно было повторить
+            uint64_t seed = options.seed;
+            if (!options.seedGiven) {
+                random_device rd;
+                seed = (uint64_t(rd()) << 32) | rd();
             }
+            cout << "Зерно генератора: " << seed << endl;
+
+            size_t start = numbers.size();
+            numbers.resize(start + count);
+            fillSeededRandom(numbers.data() + start, count, min_value, max_value, seed, generationThreads(options));
         } catch (const exception& e) {
             cerr << "Ошибка при генерации случайных чисел: " << e.what() << endl;
-            return 1;
+            return false;
         }
     }
 
-    // Проверяем, что массив не пустой
-    if (numbers.empty()) {
-        cout << "Список чисел пуст. Программа будет завершена." << endl;
+    return true;
+}
+
+/**
+ * @brief Основная функция программы
+ * 
+ * Обрабатывает пользовательский ввод, генерацию массива, сортировку и вывод в файл.
+ */
+int main(int argc, char* argv[]) {
+    vector<int> numbers;
+
+    Options options;
+    if (!parseArguments(argc, argv, options)) {
         return 1;
     }
 
-    // Записываем исходный список в файл
-    if (!writeToFile(numbers, initialFileName)) {
-        cout << "Не удалось сохранить исходный список. Программа будет завершена." << endl;
-        return 1;
+    if (!options.simd) {
+        useScalarSortKernels();
     }
-    cout << "Исходный список сохранен в файл: " << initialFileName << endl;
 
-    // Создаем копии для двух методов сортировки
-    vector<int> mergeSortNumbers = numbers;
-    vector<int> shakerSortNumbers = numbers;
+    if (options.benchmark) {
+        if (options.keyType == "int64") {
+            return runBenchmark<int64_t>(options);
+        } else if (options.keyType == "double") {
+            return runBenchmark<double>(options);
+        }
+        return runBenchmark<int>(options);
+    }
 
-    // Выполняем прямую сортировку слиянием
-    try {
-        mergeSort(mergeSortNumbers, 0, mergeSortNumbers.size() - 1);
-    } catch (const exception& e) {
-        cerr << "Ошибка при выполнении сортировки слиянием: " << e.what() << endl;
+    vector<SortAlgorithm<int>> algorithms;
+    if (!chooseAlgorithms(options, algorithms)) {
         return 1;
     }
     
-    // Выполняем шейкерную сортировку
-    try {
-        shakerSort(shakerSortNumbers);
-    } catch (const exception& e) {
-        cerr << "Ошибка при выполнении шейкерной сортировки: " << e.what() << endl;
+    // Настраиваем вывод на русском языке
+    setlocale(LC_ALL, "Russian");
+    
+    // Создаем имена файлов с временной меткой для уникальности
+    time_t now = time(0);
+    string timestamp = to_string(now);
+    string initialFileName = "original_data_" + timestamp + fileExtension(options.format);
+
+    // Внешняя сортировка файла, не помещающегося в память
+    if (!options.externalInput.empty()) {
+        string externalFileName = "sorted_by_external_merge_" + timestamp + ".txt";
+        string tempPrefix = "external_run_" + timestamp + "_";
+        cout << "Внешняя сортировка файла " << options.externalInput
+             << " (ограничение памяти: " << options.memoryMegabytes << " МБ)..." << endl;
+        if (!externalMergeSort(options.externalInput, externalFileName, tempPrefix,
+                               options.memoryMegabytes * 1024 * 1024, options.threads)) {
+            cout << "Не удалось выполнить внешнюю сортировку." << endl;
+            return 1;
+        }
+        cout << "Список, отсортированный внешним слиянием, сохранен в файл: " << externalFileName << endl;
+        return 0;
+    }
+
+    if (!options.inputFile.empty()) {
+        // Исходные числа из файла (текстового или двоичного)
+        if (!readFromFile(options.inputFile, numbers)) {
+            cout << "Не удалось прочитать файл " << options.inputFile << ". Программа будет завершена." << endl;
+            return 1;
+        }
+        cout << "Прочитано чисел из файла " << options.inputFile << ": " << numbers.size() << endl;
+    } else if (options.generateCount > 0) {
+        // Генерация по зерну без вопросов пользователю
+        numbers.resize(options.generateCount);
+        fillSeededRandom(numbers.data(), numbers.size(), options.generateMin, options.generateMax,
+                         options.seed, generationThreads(options));
+        cout << "Сгенерировано чисел: " << numbers.size() << " (зерно " << options.seed << ")" << endl;
+    } else if (!fillNumbersInteractively(numbers, options)) {
         return 1;
     }
 
-    // Записываем отсортированные списки в файлы
-    bool mergeSortSuccess = writeToFile(mergeSortNumbers, mergeSortFileName);
-    bool shakerSortSuccess = writeToFile(shakerSortNumbers, shakerSortFileName);
+    // Проверяем, что массив не пустой
+    if (numbers.empty()) {
+        cout << "Список чисел пуст. Программа будет завершена." << endl;
+        return 1;
+    }
 
-    if (mergeSortSuccess) {
-        cout << "Список, отсортированный методом прямого слияния, сохранен в файл: " << mergeSortFileName << endl;
-    } else {
-        cout << "Не удалось сохранить список, отсортированный методом прямого слияния." << endl;
+    // Записываем исходный список в файл
+    if (!writeToFile(numbers, initialFileName, options.format)) {
+        cout << "Не удалось сохранить исходный список. Программа будет завершена." << endl;
+        return 1;
     }
+    cout << "Исходный список сохранен в файл: " << initialFileName << endl;
 
-    if (shakerSortSuccess) {
-        cout << "Список, отсортированный шейкерным методом, сохранен в файл: " << shakerSortFileName << endl;
-    } else {
-        cout << "Не удалось сохранить список, отсортированный шейкерным методом." << endl;
+    // Сортируем копию исходного списка каждым выбранным методом
+    for (const auto& algorithm : algorithms) {
+        vector<int> sortedNumbers = numbers;
+        try {
+            algorithm.sort(sortedNumbers);
+        } catch (const exception& e) {
+            cerr << "Ошибка при выполнении сортировки " << algorithm.description << ": " << e.what() << endl;
+            return 1;
+        }
+
+        string fileName = algorithm.filePrefix + timestamp + fileExtension(options.format);
+        if (writeToFile(sortedNumbers, fileName, options.format)) {
+            cout << "Список, отсортированный " << algorithm.description << ", сохранен в файл: " << fileName << endl;
+        } else {
+            cout << "Не удалось сохранить список, отсортированный " << algorithm.description << "." << endl;
+        }
     }
 
     return 0;